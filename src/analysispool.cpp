@@ -0,0 +1,158 @@
+#include "analysispool.h"
+#include <algorithm>
+
+AnalysisPool::AnalysisPool(const QString &program, int engines, QObject *parent)
+    : QObject(parent), m_slots(std::max(1, engines))
+{
+    for (int i = 0; i < engineCount(); ++i) {
+        auto *engine = new UciEngine(this);
+        engine->setProgram(program);
+        connect(engine, &UciEngine::info, this, [this, i](const UciInfo &info) {
+            // Only the principal line decides the evaluation
+            if (info.hasScore && info.multiPv<=1)
+                m_slots[i].info = info;
+        });
+        connect(engine, &UciEngine::bestMove, this, [this, i](const QString &move) { onBestMove(i, move); });
+        connect(engine, &UciEngine::failed, this, [this, i](const QString &reason) { onFailed(i, reason); });
+        m_slots[i].engine = engine;
+    }
+}
+
+void AnalysisPool::setOption(const QByteArray &name, const QByteArray &value)
+{
+    for (Slot &slot : m_slots)
+        slot.engine->setOption(name, value);
+}
+
+int AnalysisPool::addGame(const QByteArray &position, const QList<QByteArray> &moves)
+{
+    const int game = int(m_games.size());
+    m_games.push_back({position, moves});
+    std::deque<Job> &queue = m_slots[shortestQueue()].queue;
+    for (int ply = 0; ply <= moves.size(); ++ply)
+        queue.push_back({game, ply});
+    if (m_started) {
+        m_done = false;
+        for (int i = 0; i < engineCount(); ++i)
+            dispatch(i);
+    }
+    return game;
+}
+
+int AnalysisPool::shortestQueue() const
+{
+    int best = -1;
+    for (int i = 0; i < engineCount(); ++i) {
+        if (m_slots[i].stats.failed)
+            continue;
+        if (best<0 || m_slots[i].queue.size() < m_slots[best].queue.size())
+            best = i;
+    }
+    return std::max(best, 0);
+}
+
+void AnalysisPool::start()
+{
+    m_started = true;
+    // Commands wait in each engine's queue until its handshake is done
+    for (int i = 0; i < engineCount(); ++i) {
+        m_slots[i].engine->start();
+        dispatch(i);
+    }
+}
+
+QByteArray AnalysisPool::positionCommand(const Job &job) const
+{
+    const Game &game = m_games[job.game];
+    QByteArray command = game.position;
+    if (job.ply>0) {
+        command += " moves";
+        for (int i = 0; i < job.ply; ++i) {
+            command += ' ';
+            command += game.moves[i];
+        }
+    }
+    return command;
+}
+
+bool AnalysisPool::steal(int thief)
+{
+    int victim = -1;
+    for (int i = 0; i < engineCount(); ++i) {
+        if (i!=thief && (victim<0 || m_slots[i].queue.size() > m_slots[victim].queue.size()))
+            victim = i;
+    }
+    if (victim<0 || m_slots[victim].queue.empty())
+        return false;
+    // The back is the work its owner would reach last
+    m_slots[thief].queue.push_back(m_slots[victim].queue.back());
+    m_slots[victim].queue.pop_back();
+    ++m_slots[thief].stats.stolen;
+    return true;
+}
+
+void AnalysisPool::dispatch(int engine)
+{
+    Slot &slot = m_slots[engine];
+    if (slot.busy || slot.stats.failed)
+        return;
+    if (slot.queue.empty() && !steal(engine)) {
+        const bool idle = std::none_of(m_slots.cbegin(), m_slots.cend(), [](const Slot &s) { return s.busy; });
+        if (idle && !m_done) {
+            m_done = true;
+            emit finished();
+        }
+        return;
+    }
+    slot.current = slot.queue.front();
+    slot.queue.pop_front();
+    slot.busy = true;
+    slot.info = UciInfo();
+    slot.clock.start();
+    slot.engine->go(positionCommand(slot.current), m_go);
+}
+
+void AnalysisPool::onBestMove(int engine, const QString &move)
+{
+    Slot &slot = m_slots[engine];
+    if (!slot.busy)
+        return;
+    slot.busy = false;
+    slot.stats.busyMs += slot.clock.elapsed();
+    ++slot.stats.positions;
+
+    AnalysisResult result;
+    result.game = slot.current.game;
+    result.ply = slot.current.ply;
+    result.engine = engine;
+    // Engines answer a finished game with "(none)" or "0000"
+    result.bestMove = move.size()>=4 && move.at(0).isLetter() ? move : QString();
+    result.isMate = slot.info.isMate;
+    result.score = slot.info.score;
+    result.depth = slot.info.depth;
+    emit analyzed(result);
+    dispatch(engine);
+}
+
+void AnalysisPool::onFailed(int engine, const QString &reason)
+{
+    Slot &slot = m_slots[engine];
+    slot.stats.failed = true;
+    if (slot.busy) {
+        slot.busy = false;
+        slot.queue.push_front(slot.current);
+    }
+    const bool anyLeft = std::any_of(m_slots.cbegin(), m_slots.cend(), [](const Slot &s) { return !s.stats.failed; });
+    if (!anyLeft) {
+        if (!m_done) {
+            m_done = true;
+            emit failed(reason);
+        }
+        return;
+    }
+    // The rest of its work is shared out by stealing
+    for (int i = 0; i < engineCount(); ++i) {
+        if (i!=engine)
+            dispatch(i);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef ANALYSISPOOL_H
+#define ANALYSISPOOL_H
+
+#include "uciengine.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <deque>
+#include <vector>
+
+// Evaluation of one position of a game
+struct AnalysisResult
+{
+    int game = 0;
+    int ply = 0;    // moves played before the position
+    int engine = 0; // index of the engine that searched it
+    QString bestMove;
+    bool isMate = false;
+    int score = 0;  // side to move's view: centipawns, or moves to mate
+    int depth = 0;
+};
+
+// Runs a set of UCI engine processes and keeps each one busy with positions
+// of the games it is given. Every engine owns a queue; a game's positions go
+// to one queue in order so consecutive searches reuse the engine's hash,
+// and an engine whose queue runs dry steals from the back of the longest
+// one. All dispatching happens on the owner's event loop, so the queues
+// need no locking.
+class AnalysisPool : public QObject
+{
+    Q_OBJECT
+public:
+    struct EngineStats
+    {
+        int positions = 0;
+        int stolen = 0;      // positions taken from another engine's queue
+        qint64 busyMs = 0;   // time between go and bestmove
+        bool failed = false;
+    };
+
+    AnalysisPool(const QString &program, int engines, QObject *parent = nullptr);
+
+    // Applies to every engine; call before start()
+    void setOption(const QByteArray &name, const QByteArray &value);
+    void setGoCommand(const QByteArray &go) { m_go = go; }
+    // Queues every position of a game, from the one position describes to
+    // the one after the last move; returns the game's index
+    int addGame(const QByteArray &position, const QList<QByteArray> &moves);
+
+    void start();
+    int engineCount() const { return int(m_slots.size()); }
+    EngineStats stats(int engine) const { return m_slots[engine].stats; }
+
+signals:
+    void analyzed(const AnalysisResult &result);
+    // Every queued position has been searched
+    void finished();
+    // No engine is left to run the remaining positions
+    void failed(const QString &reason);
+
+private:
+    struct Job
+    {
+        int game;
+        int ply;
+    };
+    struct Game
+    {
+        QByteArray position;
+        QList<QByteArray> moves;
+    };
+    struct Slot
+    {
+        UciEngine *engine = nullptr;
+        std::deque<Job> queue;
+        bool busy = false;
+        Job current{};
+        UciInfo info; // latest report of the current search
+        QElapsedTimer clock;
+        EngineStats stats;
+    };
+
+    void dispatch(int engine);
+    bool steal(int thief);
+    void onBestMove(int engine, const QString &move);
+    void onFailed(int engine, const QString &reason);
+    QByteArray positionCommand(const Job &job) const;
+    int shortestQueue() const;
+
+    std::vector<Slot> m_slots;
+    std::vector<Game> m_games;
+    QByteArray m_go = "go depth 12";
+    bool m_started = false;
+    bool m_done = false;
+};
+
+#endif // ANALYSISPOOL_H
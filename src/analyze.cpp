@@ -0,0 +1,213 @@
+// Command-line batch analysis: evaluates every position of every game of a
+// PGN file on a pool of UCI engines and prints the evaluation, the engine's
+// choice and how much each move played gave away.
+#include "analysispool.h"
+#include "chessboard.h"
+#include "pgn.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Mate scores count as this many centipawns, less the moves to mate, so a
+// quicker mate is worth more and losses stay comparable with normal scores
+constexpr int MateCp = 10000;
+
+struct Thresholds
+{
+    int inaccuracy;
+    int mistake;
+    int blunder;
+};
+
+struct GameState
+{
+    int number = 0; // 1-based in the file
+    bool whiteStarts = true;
+    QList<QByteArray> moves;
+    std::vector<AnalysisResult> results; // one per position, by ply
+    std::vector<bool> done;
+    int pending = 0;
+};
+
+int centipawns(const AnalysisResult &r)
+{
+    if (!r.isMate)
+        return std::clamp(r.score, -MateCp, MateCp);
+    // "mate 0" is the side to move being mated
+    return r.score>0 ? MateCp - r.score : -MateCp - r.score;
+}
+
+QString formatScore(bool isMate, int score)
+{
+    return isMate ? QString("#%1").arg(score) : QString::number(score);
+}
+
+// One line per move once every position of the game has been searched:
+// the evaluation after the move from White's side, the engine's choice in
+// the position before it, and the centipawns the move lost
+void printGame(std::FILE *out, const GameState &g, const Thresholds &t, int counts[3])
+{
+    for (int ply = 0; ply < g.moves.size(); ++ply) {
+        const AnalysisResult &before = g.results[ply];
+        const AnalysisResult &after = g.results[ply + 1];
+        const bool best = before.bestMove.toUtf8()==g.moves[ply];
+        const int loss = best ? 0 : std::max(0, centipawns(before) + centipawns(after));
+        const char *flag = "";
+        if (loss>=t.blunder) {
+            flag = "blunder";
+            ++counts[2];
+        } else if (loss>=t.mistake) {
+            flag = "mistake";
+            ++counts[1];
+        } else if (loss>=t.inaccuracy) {
+            flag = "inaccuracy";
+            ++counts[0];
+        }
+        // after is from the point of view of the side that did not move
+        const bool whiteMoved = (ply % 2==0)==g.whiteStarts;
+        const int whiteScore = whiteMoved ? -after.score : after.score;
+        std::fprintf(out, "%d\t%d\t%s\t%s\t%s\t%d\t%s\n", g.number, ply + 1, g.moves[ply].constData(),
+                     qPrintable(formatScore(after.isMate, whiteScore)),
+                     before.bestMove.isEmpty() ? "-" : qPrintable(before.bestMove), loss, flag);
+    }
+    std::fflush(out);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Trace::Session traceSession;
+    QCoreApplication::setApplicationName("chessqt_analyze");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Evaluates every move of the games in a PGN file with a pool of UCI engines.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "PGN file to read.");
+    QCommandLineOption engineOpt({"e", "engine"}, "UCI engine executable.", "path", "stockfish");
+    QCommandLineOption enginesOpt({"j", "engines"}, "Engine processes to run.", "n",
+                                  QString::number(std::max(1, QThread::idealThreadCount())));
+    QCommandLineOption threadsOpt("threads", "Search threads per engine.", "n", "1");
+    QCommandLineOption hashOpt("hash", "Hash table per engine in megabytes.", "mb", "16");
+    QCommandLineOption depthOpt("depth", "Search each position to <n> plies.", "n", "12");
+    QCommandLineOption movetimeOpt("movetime", "Search each position for <ms> instead of to a depth.", "ms");
+    QCommandLineOption nodesOpt("nodes", "Search each position for <n> nodes instead of to a depth.", "n");
+    QCommandLineOption outputOpt({"o", "output"}, "Write the move lines to <file> instead of stdout.", "file");
+    QCommandLineOption inaccuracyOpt("inaccuracy", "Centipawn loss that marks an inaccuracy.", "cp", "50");
+    QCommandLineOption mistakeOpt("mistake", "Centipawn loss that marks a mistake.", "cp", "100");
+    QCommandLineOption blunderOpt("blunder", "Centipawn loss that marks a blunder.", "cp", "300");
+    parser.addOptions({engineOpt, enginesOpt, threadsOpt, hashOpt, depthOpt, movetimeOpt,
+                       nodesOpt, outputOpt, inaccuracyOpt, mistakeOpt, blunderOpt});
+    parser.process(app);
+
+    if (parser.positionalArguments().size()!=1)
+        parser.showHelp(2);
+    const Thresholds thresholds{parser.value(inaccuracyOpt).toInt(), parser.value(mistakeOpt).toInt(),
+                                parser.value(blunderOpt).toInt()};
+
+    QFile file(parser.positionalArguments().first());
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(file.fileName()), qPrintable(file.errorString()));
+        return 2;
+    }
+    std::FILE *out = stdout;
+    if (parser.isSet(outputOpt)) {
+        out = std::fopen(qPrintable(parser.value(outputOpt)), "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(outputOpt)));
+            return 2;
+        }
+    }
+
+    AnalysisPool pool(parser.value(engineOpt), parser.value(enginesOpt).toInt());
+    pool.setOption("Threads", parser.value(threadsOpt).toUtf8());
+    pool.setOption("Hash", parser.value(hashOpt).toUtf8());
+    if (parser.isSet(movetimeOpt))
+        pool.setGoCommand("go movetime " + parser.value(movetimeOpt).toUtf8());
+    else if (parser.isSet(nodesOpt))
+        pool.setGoCommand("go nodes " + parser.value(nodesOpt).toUtf8());
+    else
+        pool.setGoCommand("go depth " + parser.value(depthOpt).toUtf8());
+
+    // Games are replayed up front; the positions are sent as the start
+    // position plus the moves so engines see repetitions
+    const QByteArray data = file.readAll();
+    std::vector<std::string_view> texts;
+    Pgn::splitGames(std::string_view(data.constData(), std::size_t(data.size())), true, texts);
+    std::vector<GameState> games;
+    games.reserve(texts.size());
+    int skipped = 0, positions = 0;
+    ChessBoard board;
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        GameState g;
+        g.number = int(i) + 1;
+        const Pgn::Replay r = Pgn::replay(texts[i], board, [&g](const ChessBoard &, Move m) {
+            g.moves.append(QByteArray::fromStdString(ChessBoard::toUci(m)));
+        });
+        if (!r.error.empty()) {
+            std::fprintf(stderr, "game %d skipped: %s\n", g.number, r.error.c_str());
+            ++skipped;
+            continue;
+        }
+        g.whiteStarts = (board.currentColor()==ChessBoard::White)==(g.moves.size() % 2==0);
+        const std::string_view fen = Pgn::tag(texts[i], "FEN");
+        const QByteArray start = fen.empty() ? QByteArray("position startpos")
+                                             : "position fen " + QByteArray(fen.data(), qsizetype(fen.size()));
+        g.pending = int(g.moves.size()) + 1;
+        g.results.resize(std::size_t(g.pending));
+        g.done.resize(std::size_t(g.pending));
+        positions += g.pending;
+        pool.addGame(start, g.moves);
+        games.push_back(std::move(g));
+    }
+    if (games.empty()) {
+        std::fprintf(stderr, "no games to analyze\n");
+        return skipped>0 ? 1 : 0;
+    }
+
+    int counts[3] = {0, 0, 0};
+    int searched = 0;
+    QElapsedTimer clock;
+    std::fprintf(out, "game\tply\tmove\teval\tbest\tloss\tflag\n");
+    QObject::connect(&pool, &AnalysisPool::analyzed, &app, [&](const AnalysisResult &r) {
+        GameState &g = games[std::size_t(r.game)];
+        if (g.done[std::size_t(r.ply)])
+            return;
+        g.done[std::size_t(r.ply)] = true;
+        g.results[std::size_t(r.ply)] = r;
+        ++searched;
+        if (--g.pending==0)
+            printGame(out, g, thresholds, counts);
+    });
+    QObject::connect(&pool, &AnalysisPool::finished, &app, [&app] { app.exit(0); });
+    QObject::connect(&pool, &AnalysisPool::failed, &app, [&app](const QString &reason) {
+        std::fprintf(stderr, "engines failed: %s\n", qPrintable(reason));
+        app.exit(2);
+    });
+    clock.start();
+    pool.start();
+    const int status = app.exec();
+    const double secs = clock.elapsed() / 1000.0;
+    if (out!=stdout)
+        std::fclose(out);
+
+    std::fprintf(stderr, "Games: %zu\nSkipped: %d\nPositions: %d of %d\nTime: %.3f s\nPositions/s: %.1f\n",
+                 games.size(), skipped, searched, positions, secs, secs>0 ? searched / secs : 0.0);
+    std::fprintf(stderr, "Inaccuracies: %d\nMistakes: %d\nBlunders: %d\n", counts[0], counts[1], counts[2]);
+    for (int i = 0; i < pool.engineCount(); ++i) {
+        const AnalysisPool::EngineStats s = pool.stats(i);
+        std::fprintf(stderr, "Engine %d: %d positions, %d stolen, %.1f%% busy%s\n", i + 1, s.positions, s.stolen,
+                     secs>0 ? 100.0 * s.busyMs / 1000.0 / secs : 0.0, s.failed ? ", failed" : "");
+    }
+    return status!=0 ? status : (skipped>0 ? 1 : 0);
+}
@@ -0,0 +1,276 @@
+// Command-line search benchmark: runs the built-in engine on a set of
+// positions and reports speed and depth for every search thread, or times
+// the evaluation functions.
+#include "evaluate.h"
+#include "nnue.h"
+#include "search.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::vector<const char *> BenchFens{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+void printPv(const SearchResult &r)
+{
+    std::printf("depth %d score %d nodes %llu time %lld pv", r.depth, r.score,
+                static_cast<unsigned long long>(r.nodes), static_cast<long long>(r.time));
+    for (Move m : r.pv)
+        std::printf(" %s", ChessBoard::toUci(m).c_str());
+    std::printf("\n");
+}
+
+struct Line
+{
+    ChessBoard start;
+    std::vector<Move> moves;
+};
+
+// Random legal lines from the bench positions, so the evaluation benchmark
+// sees the same mix of quiet moves, captures and king moves on every run.
+std::vector<Line> randomLines(int perPosition, int length)
+{
+    std::uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    auto next = [&seed] {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+    std::vector<Line> lines;
+    for (const char *fen : BenchFens) {
+        for (int i = 0; i < perPosition; ++i) {
+            Line line;
+            line.start.setFen(fen);
+            ChessBoard board = line.start;
+            for (int ply = 0; ply < length; ++ply) {
+                MoveList moves;
+                board.legalMoves(moves);
+                if (moves.isEmpty())
+                    break;
+                Move m = moves[int(next() % std::uint64_t(moves.size()))];
+                ChessBoard::Undo undo;
+                board.makeMove(m, undo);
+                line.moves.push_back(m);
+            }
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Incremental network evaluation along random lines with every available
+// kernel, checked against a full refresh, then full refreshes and the
+// hand-written evaluation for comparison.
+int runEvalBench(int rounds)
+{
+    const std::vector<Line> lines = randomLines(32, 64);
+    Nnue::AccumulatorStack stack;
+    long long checksum = 0;
+
+    const QString selected = Nnue::kernel();
+    for (const QString &name : Nnue::kernels()) {
+        Nnue::selectKernel(name);
+        for (const Line &line : lines) {
+            ChessBoard board = line.start;
+            stack.reset(board);
+            for (Move m : line.moves) {
+                ChessBoard::Undo undo;
+                board.makeMove(m, undo);
+                stack.push(board, m, undo);
+                if (stack.evaluate(board.currentColor())!=Nnue::evaluate(board)) {
+                    std::fprintf(stderr, "%s: incremental eval differs after %s in %s\n", qPrintable(name),
+                                 ChessBoard::toUci(m).c_str(), board.toFen().c_str());
+                    return 1;
+                }
+            }
+        }
+
+        unsigned long long evals = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const Line &line : lines) {
+                ChessBoard board = line.start;
+                stack.reset(board);
+                std::vector<ChessBoard::Undo> undos(line.moves.size());
+                for (std::size_t i = 0; i < line.moves.size(); ++i) {
+                    board.makeMove(line.moves[i], undos[i]);
+                    stack.push(board, line.moves[i], undos[i]);
+                    checksum += stack.evaluate(board.currentColor());
+                }
+                for (std::size_t i = line.moves.size(); i-- > 0; ) {
+                    board.unmakeMove(line.moves[i], undos[i]);
+                    stack.pop();
+                    checksum += stack.evaluate(board.currentColor());
+                }
+                evals += 2*line.moves.size();
+            }
+        }
+        double secs = secondsSince(start);
+        std::printf("nnue incremental (%s): %.0f evals/s\n", qPrintable(name), evals / secs);
+    }
+    Nnue::selectKernel(selected);
+
+    auto timeFull = [&](const char *label, int (*eval)(const ChessBoard &)) {
+        unsigned long long evals = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const Line &line : lines) {
+                ChessBoard board = line.start;
+                for (Move m : line.moves) {
+                    ChessBoard::Undo undo;
+                    board.makeMove(m, undo);
+                    checksum += eval(board);
+                    ++evals;
+                }
+            }
+        }
+        std::printf("%s: %.0f evals/s\n", label, evals / secondsSince(start));
+    };
+    timeFull("nnue full refresh", Nnue::evaluate);
+    timeFull("hand-written", Evaluation::evaluate);
+
+    // How far the network is from the evaluation the engine uses without it
+    long long positions = 0, totalDiff = 0;
+    int maxDiff = 0;
+    for (const Line &line : lines) {
+        ChessBoard board = line.start;
+        for (Move m : line.moves) {
+            ChessBoard::Undo undo;
+            board.makeMove(m, undo);
+            const int diff = std::abs(Nnue::evaluate(board) - Evaluation::evaluate(board));
+            totalDiff += diff;
+            maxDiff = std::max(maxDiff, diff);
+            ++positions;
+        }
+    }
+    std::printf("nnue vs hand-written: mean difference %.1f cp, max %d cp over %lld positions\n",
+                double(totalDiff) / double(std::max(1LL, positions)), maxDiff, positions);
+    std::printf("checksum %lld\n", checksum);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Trace::Session traceSession;
+    QCoreApplication::setApplicationName("chessqt_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs the built-in search and reports per-thread nodes/sec and depth.");
+    parser.addHelpOption();
+    QCommandLineOption fenOpt({"f", "fen"}, "Search <fen> instead of the bench positions.", "fen");
+    QCommandLineOption threadsOpt({"t", "threads"}, "Number of search threads.", "n",
+                                  QString::number(std::max(1u, std::thread::hardware_concurrency())));
+    QCommandLineOption hashOpt("hash", "Transposition table size in megabytes.", "mb", "64");
+    QCommandLineOption depthOpt({"d", "depth"}, "Search each position to <depth>.", "depth");
+    QCommandLineOption timeOpt({"m", "movetime"}, "Search each position for <ms> milliseconds.", "ms", "1000");
+    QCommandLineOption verboseOpt({"v", "verbose"}, "Print every completed iteration.");
+    QCommandLineOption netOpt("net", "Evaluate with the network in <file>; :/nets/default.nnue is the embedded one.", "file");
+    QCommandLineOption writeNetOpt("write-net", "Write the bootstrap network to <file> and exit.", "file");
+    QCommandLineOption kernelOpt("kernel", "Use the network kernel <name> (avx2, sse4.1, scalar).", "name");
+    QCommandLineOption evalOpt("eval", "Time the evaluation functions instead of searching.");
+    parser.addOption(fenOpt);
+    parser.addOption(threadsOpt);
+    parser.addOption(hashOpt);
+    parser.addOption(depthOpt);
+    parser.addOption(timeOpt);
+    parser.addOption(verboseOpt);
+    parser.addOption(netOpt);
+    parser.addOption(writeNetOpt);
+    parser.addOption(kernelOpt);
+    parser.addOption(evalOpt);
+    parser.process(app);
+
+    if (parser.isSet(writeNetOpt)) {
+        if (!Nnue::save(parser.value(writeNetOpt), *Nnue::bootstrapNetwork())) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value(writeNetOpt)));
+            return 2;
+        }
+        return 0;
+    }
+    if (parser.isSet(netOpt)) {
+        QString error;
+        if (!Nnue::load(parser.value(netOpt), &error)) {
+            std::fprintf(stderr, "Cannot load %s: %s\n", qPrintable(parser.value(netOpt)), qPrintable(error));
+            return 2;
+        }
+    }
+    if (parser.isSet(kernelOpt) && !Nnue::selectKernel(parser.value(kernelOpt))) {
+        std::fprintf(stderr, "Kernel %s is not available; have %s\n", qPrintable(parser.value(kernelOpt)),
+                     qPrintable(Nnue::kernels().join(", ")));
+        return 2;
+    }
+    if (parser.isSet(evalOpt)) {
+        if (!Nnue::isLoaded())
+            Nnue::setNetwork(*Nnue::bootstrapNetwork());
+        return runEvalBench(20);
+    }
+
+    SearchLimits limits;
+    if (parser.isSet(depthOpt))
+        limits.depth = std::max(1, parser.value(depthOpt).toInt());
+    else
+        limits.moveTime = std::max(1, parser.value(timeOpt).toInt());
+
+    TranspositionTable tt(std::max(1, parser.value(hashOpt).toInt()));
+    Searcher searcher(tt);
+    searcher.setThreads(parser.value(threadsOpt).toInt());
+    if (parser.isSet(verboseOpt))
+        searcher.onIteration = printPv;
+
+    QStringList fens;
+    if (parser.isSet(fenOpt))
+        fens << parser.value(fenOpt);
+    else
+        for (const char *fen : BenchFens)
+            fens << QString::fromLatin1(fen);
+
+    unsigned long long totalNodes = 0;
+    long long totalTime = 0;
+    for (const QString &fen : fens) {
+        ChessBoard board;
+        if (!board.setFen(fen.toStdString())) {
+            std::fprintf(stderr, "Invalid FEN: %s\n", qPrintable(fen));
+            return 2;
+        }
+        tt.clear();
+        std::printf("%s\n", qPrintable(fen));
+        SearchResult r = searcher.search(board, limits);
+        std::printf("bestmove %s score %d depth %d nodes %llu time %lld ms\n",
+                    ChessBoard::toUci(r.best).c_str(), r.score, r.depth,
+                    static_cast<unsigned long long>(r.nodes), static_cast<long long>(r.time));
+        for (std::size_t i = 0; i < r.threads.size(); ++i) {
+            const ThreadStats &t = r.threads[i];
+            std::printf("  thread %zu: depth %d nodes %llu nps %llu\n", i, t.depth,
+                        static_cast<unsigned long long>(t.nodes), static_cast<unsigned long long>(t.nps));
+        }
+        totalNodes += r.nodes;
+        totalTime += r.time;
+    }
+    std::printf("\nNodes: %llu\nTime: %.3f s\nNPS: %.0f\n", totalNodes, totalTime / 1000.0,
+                totalTime ? totalNodes * 1000.0 / totalTime : 0.0);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "bitboard.h"
+#include <vector>
+
+namespace Bitboards {
+
+std::array<Magic, 64> RookMagics;
+std::array<Magic, 64> BishopMagics;
+std::array<std::array<Bitboard, 64>, 64> BetweenSquares;
+std::array<std::array<Bitboard, 64>, 64> LineSquares;
+
+namespace {
+
+using Dirs = std::array<std::array<int,2>,4>;
+constexpr Dirs RookDirs{{ {{-1,0}},{{1,0}},{{0,-1}},{{0,1}} }};
+constexpr Dirs BishopDirs{{ {{-1,-1}},{{-1,1}},{{1,-1}},{{1,1}} }};
+
+// Slow reference ray walk used only to fill the lookup tables.
+Bitboard slidingAttacks(int sq, Bitboard occ, const Dirs &dirs)
+{
+    Bitboard res = 0;
+    int r = sq / 8, c = sq % 8;
+    for (const auto &o : dirs) {
+        for (int rr=r+o[0], cc=c+o[1]; rr>=0&&rr<8&&cc>=0&&cc<8; rr+=o[0], cc+=o[1]) {
+            res |= squareBit(rr*8+cc);
+            if (occ & squareBit(rr*8+cc))
+                break;
+        }
+    }
+    return res;
+}
+
+// Relevant occupancy: the attack rays without the board edges they end on.
+Bitboard relevantMask(int sq, const Dirs &dirs)
+{
+    Bitboard edges = ((rowMask(0) | rowMask(7)) & ~rowMask(sq/8))
+                   | ((colMask(0) | colMask(7)) & ~colMask(sq%8));
+    return slidingAttacks(sq, 0, dirs) & ~edges;
+}
+
+struct Prng
+{
+    std::uint64_t s;
+    std::uint64_t next()
+    {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 2685821657736338717ULL;
+    }
+    std::uint64_t sparse() { return next() & next() & next(); }
+};
+
+std::vector<Bitboard> RookTable(0x19000);
+std::vector<Bitboard> BishopTable(0x1480);
+
+void initMagics(std::array<Magic,64> &magics, std::vector<Bitboard> &table, const Dirs &dirs)
+{
+    std::array<Bitboard, 4096> occupancy{}, reference{};
+    [[maybe_unused]] std::array<int, 4096> epoch{};
+    [[maybe_unused]] int cnt = 0;
+    [[maybe_unused]] Prng rng{0x2545F4914F6CDD1DULL};
+    std::size_t offset = 0;
+
+    for (int sq = 0; sq < 64; ++sq) {
+        Magic &m = magics[sq];
+        m.mask = relevantMask(sq, dirs);
+        m.shift = 64 - popCount(m.mask);
+        m.attacks = table.data() + offset;
+
+        // Carry-rippler enumeration of every subset of the mask
+        int size = 0;
+        Bitboard b = 0;
+        do {
+            occupancy[size] = b;
+            reference[size] = slidingAttacks(sq, b, dirs);
+#if defined(__BMI2__)
+            table[offset + m.index(b)] = reference[size];
+#endif
+            ++size;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+
+#if !defined(__BMI2__)
+        Bitboard *att = table.data() + offset;
+        for (int i = 0; i < size; ) {
+            for (m.magic = 0; popCount((m.magic * m.mask) >> 56) < 6; )
+                m.magic = rng.sparse();
+            ++cnt;
+            for (i = 0; i < size; ++i) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < cnt) {
+                    epoch[idx] = cnt;
+                    att[idx] = reference[i];
+                } else if (att[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+#endif
+        offset += std::size_t(size);
+    }
+}
+
+void initLines()
+{
+    for (int a = 0; a < 64; ++a) {
+        for (const Dirs *dirs : {&RookDirs, &BishopDirs}) {
+            for (int b = 0; b < 64; ++b) {
+                if (a==b || !(slidingAttacks(a, 0, *dirs) & squareBit(b)))
+                    continue;
+                LineSquares[a][b] = (slidingAttacks(a, 0, *dirs) & slidingAttacks(b, 0, *dirs))
+                                  | squareBit(a) | squareBit(b);
+                BetweenSquares[a][b] = slidingAttacks(a, squareBit(b), *dirs)
+                                     & slidingAttacks(b, squareBit(a), *dirs);
+            }
+        }
+    }
+}
+
+struct Init
+{
+    Init()
+    {
+        initMagics(RookMagics, RookTable, RookDirs);
+        initMagics(BishopMagics, BishopTable, BishopDirs);
+        initLines();
+    }
+} init;
+
+} // namespace
+
+} // namespace Bitboards
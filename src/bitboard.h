@@ -0,0 +1,113 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// 64-bit square sets. Squares use the same indexing as ChessBoard:
+// index = row*8+col where row 0 is rank 8 and col 0 is the a-file, so a8=0
+// and h1=63.
+using Bitboard = std::uint64_t;
+
+namespace Bitboards {
+
+constexpr Bitboard squareBit(int sq) { return Bitboard(1) << sq; }
+constexpr Bitboard rowMask(int row) { return Bitboard(0xFF) << (row*8); }
+constexpr Bitboard colMask(int col) { return Bitboard(0x0101010101010101ULL) << col; }
+
+inline int lsb(Bitboard b) { return std::countr_zero(b); }
+inline int popCount(Bitboard b) { return std::popcount(b); }
+inline int popLsb(Bitboard &b)
+{
+    int sq = std::countr_zero(b);
+    b &= b - 1;
+    return sq;
+}
+
+namespace detail {
+
+template <std::size_t N>
+constexpr std::array<Bitboard, 64> leaperTable(const std::array<std::array<int,2>,N> &d)
+{
+    std::array<Bitboard, 64> t{};
+    for (int sq = 0; sq < 64; ++sq) {
+        int r = sq / 8, c = sq % 8;
+        for (const auto &o : d) {
+            int rr = r + o[0], cc = c + o[1];
+            if (rr>=0 && rr<8 && cc>=0 && cc<8)
+                t[sq] |= squareBit(rr*8+cc);
+        }
+    }
+    return t;
+}
+
+} // namespace detail
+
+inline constexpr std::array<Bitboard, 64> KnightAttacks = detail::leaperTable<8>({{
+    {{-2,-1}},{{-2,1}},{{-1,-2}},{{-1,2}},{{1,-2}},{{1,2}},{{2,-1}},{{2,1}}
+}});
+
+inline constexpr std::array<Bitboard, 64> KingAttacks = detail::leaperTable<8>({{
+    {{-1,-1}},{{-1,0}},{{-1,1}},{{0,-1}},{{0,1}},{{1,-1}},{{1,0}},{{1,1}}
+}});
+
+// PawnAttacks[color][sq]: squares attacked by a pawn of that color standing on
+// sq. Color 0 is White (moving towards row 0), 1 is Black.
+inline constexpr std::array<std::array<Bitboard, 64>, 2> PawnAttacks{{
+    detail::leaperTable<2>({{ {{-1,-1}},{{-1,1}} }}),
+    detail::leaperTable<2>({{ {{1,-1}},{{1,1}} }})
+}};
+
+// Fancy magic bitboards for sliders; with BMI2 the index is taken with PEXT
+// instead of the magic multiply. Tables are filled during static
+// initialization of bitboard.cpp.
+struct Magic
+{
+    Bitboard mask = 0;
+    Bitboard magic = 0;
+    const Bitboard *attacks = nullptr;
+    unsigned shift = 0;
+
+    unsigned index(Bitboard occ) const
+    {
+#if defined(__BMI2__)
+        return unsigned(_pext_u64(occ, mask));
+#else
+        return unsigned(((occ & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern std::array<Magic, 64> RookMagics;
+extern std::array<Magic, 64> BishopMagics;
+
+// BetweenSquares[a][b]: squares strictly between two aligned squares.
+// LineSquares[a][b]: the whole rank, file or diagonal through both squares.
+// Both are empty when the squares do not share a line.
+extern std::array<std::array<Bitboard, 64>, 64> BetweenSquares;
+extern std::array<std::array<Bitboard, 64>, 64> LineSquares;
+
+inline Bitboard rookAttacks(int sq, Bitboard occ)
+{
+    const Magic &m = RookMagics[sq];
+    return m.attacks[m.index(occ)];
+}
+
+inline Bitboard bishopAttacks(int sq, Bitboard occ)
+{
+    const Magic &m = BishopMagics[sq];
+    return m.attacks[m.index(occ)];
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occ)
+{
+    return rookAttacks(sq, occ) | bishopAttacks(sq, occ);
+}
+
+} // namespace Bitboards
+
+#endif // BITBOARD_H
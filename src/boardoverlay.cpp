@@ -0,0 +1,114 @@
+#include "boardoverlay.h"
+#include <QPainterPath>
+#include <QRadialGradient>
+#include <QPen>
+#include <QtMath>
+
+namespace {
+
+// Stacking order within the scene; squares are at 0 and pieces at 1
+constexpr qreal LastMoveZ = 0.2;
+constexpr qreal CheckZ = 0.3;
+constexpr qreal HighlightZ = 0.5;
+constexpr qreal ArrowZ = 2;
+
+} // namespace
+
+BoardOverlay::BoardOverlay(QGraphicsScene *scene, int squareSize)
+    : m_size(squareSize)
+{
+    for (int sq = 0; sq < 64; ++sq) {
+        auto *item = scene->addRect(0, 0, m_size, m_size, Qt::NoPen, QColor(255, 255, 0, 160));
+        item->setPos((sq%8)*m_size, (sq/8)*m_size);
+        item->setZValue(HighlightZ);
+        item->setVisible(false);
+        m_highlights[sq] = item;
+    }
+    for (auto &item : m_lastMove) {
+        item = scene->addRect(0, 0, m_size, m_size, Qt::NoPen, QColor(155, 199, 0, 105));
+        item->setZValue(LastMoveZ);
+        item->setVisible(false);
+    }
+
+    QRadialGradient glow(QPointF(m_size/2.0, m_size/2.0), m_size/2.0);
+    glow.setColorAt(0, QColor(255, 0, 0, 220));
+    glow.setColorAt(0.6, QColor(230, 0, 0, 120));
+    glow.setColorAt(1, QColor(170, 0, 0, 0));
+    m_check = scene->addEllipse(0, 0, m_size, m_size, Qt::NoPen, glow);
+    m_check->setZValue(CheckZ);
+    m_check->setVisible(false);
+
+    QPen pen(QColor(0, 120, 215, 170), m_size*0.18, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    m_arrow = scene->addPath(QPainterPath(), pen, QColor(0, 120, 215, 170));
+    m_arrow->setZValue(ArrowZ);
+    m_arrow->setVisible(false);
+}
+
+QPointF BoardOverlay::center(int sq) const
+{
+    return QPointF((sq%8 + 0.5)*m_size, (sq/8 + 0.5)*m_size);
+}
+
+void BoardOverlay::setHighlights(const std::bitset<64> &squares)
+{
+    const std::bitset<64> changed = squares ^ m_shown;
+    for (int sq = 0; sq < 64; ++sq)
+        if (changed.test(sq))
+            m_highlights[sq]->setVisible(squares.test(sq));
+    m_shown = squares;
+}
+
+void BoardOverlay::setLastMove(int from, int to)
+{
+    const int squares[2] = {from, to};
+    for (int i = 0; i < 2; ++i) {
+        m_lastMove[i]->setVisible(squares[i]>=0);
+        if (squares[i]>=0)
+            m_lastMove[i]->setPos((squares[i]%8)*m_size, (squares[i]/8)*m_size);
+    }
+}
+
+void BoardOverlay::setCheck(int sq)
+{
+    m_check->setVisible(sq>=0);
+    if (sq>=0)
+        m_check->setPos((sq%8)*m_size, (sq/8)*m_size);
+}
+
+void BoardOverlay::setArrow(int from, int to)
+{
+    if (from<0 || to<0 || from==to) {
+        m_arrow->setVisible(false);
+        m_arrowFrom = m_arrowTo = -1;
+        return;
+    }
+    m_arrow->setVisible(true);
+    if (from==m_arrowFrom && to==m_arrowTo)
+        return;
+    m_arrowFrom = from;
+    m_arrowTo = to;
+
+    // Shaft stops at the base of the head so the round cap does not poke out
+    const QPointF a = center(from), b = center(to);
+    const qreal angle = qAtan2(b.y()-a.y(), b.x()-a.x());
+    const qreal head = m_size*0.45;
+    const QPointF dir(qCos(angle), qSin(angle));
+    const QPointF normal(-dir.y(), dir.x());
+    const QPointF base = b - dir*head;
+    QPainterPath path(a);
+    path.lineTo(base);
+    QPainterPath tip(b);
+    tip.lineTo(base + normal*head*0.6);
+    tip.lineTo(base - normal*head*0.6);
+    tip.closeSubpath();
+    path.addPath(tip);
+    m_arrow->setPath(path);
+}
+
+void BoardOverlay::clear()
+{
+    setHighlights({});
+    setLastMove(-1, -1);
+    setCheck(-1);
+    setArrow(-1, -1);
+}
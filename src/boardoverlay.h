@@ -0,0 +1,39 @@
+#ifndef BOARDOVERLAY_H
+#define BOARDOVERLAY_H
+
+#include <QGraphicsScene>
+#include <QGraphicsRectItem>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsPathItem>
+#include <array>
+#include <bitset>
+
+// Markers drawn over the board squares: legal-move highlights, the last
+// move, a king in check and an engine arrow. All items are created once and
+// only shown, hidden or moved, so the squares and pieces below are never
+// touched. Squares are row*8+col like ChessBoard, -1 meaning none.
+class BoardOverlay
+{
+public:
+    BoardOverlay(QGraphicsScene *scene, int squareSize);
+
+    void setHighlights(const std::bitset<64> &squares);
+    void setLastMove(int from, int to);
+    void setCheck(int sq);
+    void setArrow(int from, int to);
+    void clear();
+
+private:
+    QPointF center(int sq) const;
+
+    int m_size;
+    std::array<QGraphicsRectItem *, 64> m_highlights{};
+    std::bitset<64> m_shown;
+    std::array<QGraphicsRectItem *, 2> m_lastMove{};
+    QGraphicsEllipseItem *m_check = nullptr;
+    QGraphicsPathItem *m_arrow = nullptr;
+    int m_arrowFrom = -1;
+    int m_arrowTo = -1;
+};
+
+#endif // BOARDOVERLAY_H
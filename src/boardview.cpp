@@ -21,11 +21,15 @@ void BoardView::mousePressEvent(QMouseEvent *event)
         ChessBoard::Piece p = m_board->pieceAt(r,c);
         if (p!=ChessBoard::Empty && m_board->pieceColor(p)==m_board->currentColor()) {
             m_selected = coord;
-            m_moves = m_board->legalMoves(coord);
+            m_moves.clear();
+            for (Bitboard b = m_board->legalTargets(r*8+c); b; ) {
+                const int sq = Bitboards::popLsb(b);
+                m_moves.append(QPoint(sq/8, sq%8));
+            }
             emit highlightChanged(m_moves);
         }
     } else {
-        if (m_board->move(m_selected, coord)) {
+        if (m_board->move(m_selected.toStdString(), coord.toStdString())) {
             m_selected.clear();
             m_moves.clear();
             emit boardChanged();
@@ -1,11 +1,14 @@
 #include "chessboard.h"
-#include "utils.h"
+#include "trace.h"
+#include "zobrist.h"
+#include <cctype>
 #include <numeric>
 #include <algorithm>
 #include <array>
 
 ChessBoard::ChessBoard()
 {
+    m_keyHistory.reserve(512);
     reset();
 }
 
@@ -21,90 +24,339 @@ void ChessBoard::reset()
         WP, WP, WP, WP, WP, WP, WP, WP,
         WR, WN, WB, WQ, WK, WB, WN, WR
     }};
-    m_board = init;
+    m_board.fill(Empty);
+    m_pieces.fill(0);
+    m_colors.fill(0);
+    m_key = 0;
+    for (int sq = 0; sq < 64; ++sq)
+        putPiece(sq, init[sq]);
     m_turn = White;
     m_history.clear();
-    m_whiteKingMoved = false;
-    m_blackKingMoved = false;
-    m_whiteLeftRookMoved = false;
-    m_whiteRightRookMoved = false;
-    m_blackLeftRookMoved = false;
-    m_blackRightRookMoved = false;
-    m_enPassant = QPoint(-1,-1);
+    m_startFen.clear();
+    m_keyHistory.clear();
+    m_castling = WhiteKingSide | WhiteQueenSide | BlackKingSide | BlackQueenSide;
+    m_enPassant = -1;
+    m_rule50 = 0;
+    m_gamePly = 0;
+    m_key ^= stateKey();
 }
 
-static void strToPos(const QString &s,int &r,int &c)
+void ChessBoard::putPiece(int sq, Piece p)
 {
-    c = s[0].toLatin1()-'a';
-    r = 7 - (s[1].digitValue()-1);
+    removePiece(sq);
+    if (p==Empty)
+        return;
+    m_board[sq] = p;
+    m_pieces[p] |= Bitboards::squareBit(sq);
+    m_colors[pieceColor(p)] |= Bitboards::squareBit(sq);
+    m_key ^= Zobrist::keys.psq[p][sq];
 }
 
-bool ChessBoard::move(const QString &from, const QString &to)
+void ChessBoard::removePiece(int sq)
 {
-    QVector<QPoint> moves = legalMoves(from);
-    int tr,tc; strToPos(to,tr,tc);
-    // Use std::any_of with a lambda to check if the move is legal
-    bool legal = std::any_of(moves.cbegin(), moves.cend(), [&](const QPoint &p){
-        return p.x()==tr && p.y()==tc;
-    });
-    if (!legal)
+    Piece p = m_board[sq];
+    if (p==Empty)
+        return;
+    m_pieces[p] &= ~Bitboards::squareBit(sq);
+    m_colors[pieceColor(p)] &= ~Bitboards::squareBit(sq);
+    m_board[sq] = Empty;
+    m_key ^= Zobrist::keys.psq[p][sq];
+}
+
+// Key of everything but piece placement. The en-passant file only counts
+// when a pawn of the side to move could actually capture there, so
+// positions that differ in nothing else repeat as they should.
+std::uint64_t ChessBoard::stateKey() const
+{
+    std::uint64_t k = Zobrist::keys.castling[m_castling];
+    if (m_turn==Black)
+        k ^= Zobrist::keys.side;
+    if (m_enPassant!=-1) {
+        Color them = (m_turn==White)?Black:White;
+        if (Bitboards::PawnAttacks[them][m_enPassant] & m_pieces[m_turn==White?WP:BP])
+            k ^= Zobrist::keys.enPassant[m_enPassant%8];
+    }
+    return k;
+}
+
+int ChessBoard::repetitions() const
+{
+    int count = 0;
+    int n = int(m_keyHistory.size());
+    int limit = std::min(m_rule50, n);
+    for (int k = 2; k <= limit; k += 2) {
+        if (m_keyHistory[n-k]==m_key)
+            ++count;
+    }
+    return count;
+}
+
+bool ChessBoard::isInsufficientMaterial() const
+{
+    if (m_pieces[WP] | m_pieces[BP] | m_pieces[WR] | m_pieces[BR] | m_pieces[WQ] | m_pieces[BQ])
         return false;
-    int fr,fc; strToPos(from,fr,fc);
-    int fi = fr*8+fc;
-    int ti = tr*8+tc;
-
-    Piece moving = m_board[fi];
-
-    // handle castling
-    if (moving==WK && abs(tc-fc)==2) {
-        // king side or queen side
-        if (tc>fc) { // king side
-            m_board[tr*8+5] = m_board[tr*8+7];
-            m_board[tr*8+7] = Empty;
-        } else {
-            m_board[tr*8+3] = m_board[tr*8+0];
-            m_board[tr*8+0] = Empty;
-        }
+    const Bitboard knights = m_pieces[WN] | m_pieces[BN];
+    const Bitboard bishops = m_pieces[WB] | m_pieces[BB];
+    if (Bitboards::popCount(knights | bishops)<=1)
+        return true;
+    // a8 is light and square colours alternate along ranks and files
+    constexpr Bitboard Light = 0xAA55AA55AA55AA55ULL;
+    return !knights && (!(bishops & Light) || !(bishops & ~Light));
+}
+
+int ChessBoard::parseSquare(std::string_view name)
+{
+    if (name.size()!=2 || name[0]<'a' || name[0]>'h' || name[1]<'1' || name[1]>'8')
+        return -1;
+    return (7 - (name[1]-'1'))*8 + (name[0]-'a');
+}
+
+std::string ChessBoard::squareName(int sq)
+{
+    return {char('a' + sq%8), char('8' - sq/8)};
+}
+
+bool ChessBoard::move(std::string_view from, std::string_view to)
+{
+    const int f = parseSquare(from);
+    const int t = parseSquare(to);
+    return f>=0 && t>=0 && move(f, t);
+}
+
+bool ChessBoard::move(int from, int to, Piece promotion)
+{
+    Move::PromotionPiece promo = Move::Queen;
+    switch (promotion) {
+    case WN: case BN: promo = Move::Knight; break;
+    case WB: case BB: promo = Move::Bishop; break;
+    case WR: case BR: promo = Move::Rook; break;
+    default: break;
+    }
+    MoveList list;
+    legalMoves(from, list);
+    for (Move m : list) {
+        if (m.to()==to && (m.kind()!=Move::Promotion || m.promotion()==promo))
+            return move(m);
+    }
+    return false;
+}
+
+bool ChessBoard::move(Move m)
+{
+    MoveList list;
+    legalMoves(m.from(), list);
+    if (!list.contains(m))
+        return false;
+    Undo undo;
+    makeMove(m, undo);
+    m_history.push_back(toUci(m));
+    return true;
+}
+
+void ChessBoard::legalMoves(MoveList &list) const
+{
+    TRACE_SCOPE("ChessBoard::legalMoves");
+    list.clear();
+    const CheckInfo info = checkInfo(m_turn);
+    for (Bitboard b = m_colors[m_turn]; b; ) {
+        int from = Bitboards::popLsb(b);
+        addMoves(from, legalTargets(from, info), list);
     }
-    if (moving==BK && abs(tc-fc)==2) {
-        if (tc>fc) {
-            m_board[tr*8+5] = m_board[tr*8+7];
-            m_board[tr*8+7] = Empty;
+}
+
+void ChessBoard::legalMoves(int from, MoveList &list) const
+{
+    list.clear();
+    addMoves(from, legalTargets(from), list);
+}
+
+// Expands a target mask into moves, tagging promotions (one per piece),
+// en-passant captures and castling.
+void ChessBoard::addMoves(int from, Bitboard targets, MoveList &list) const
+{
+    Piece p = m_board[from];
+    bool pawn = (p==WP || p==BP);
+    bool king = (p==WK || p==BK);
+    while (targets) {
+        int to = Bitboards::popLsb(targets);
+        if (pawn && (to/8==0 || to/8==7)) {
+            list.push(Move(from, to, Move::Promotion, Move::Queen));
+            list.push(Move(from, to, Move::Promotion, Move::Knight));
+            list.push(Move(from, to, Move::Promotion, Move::Rook));
+            list.push(Move(from, to, Move::Promotion, Move::Bishop));
+        } else if (pawn && to==m_enPassant) {
+            list.push(Move(from, to, Move::EnPassant));
+        } else if (king && abs(to-from)==2) {
+            list.push(Move(from, to, Move::Castling));
         } else {
-            m_board[tr*8+3] = m_board[tr*8+0];
-            m_board[tr*8+0] = Empty;
+            list.push(Move(from, to));
         }
     }
+}
+
+std::string ChessBoard::toUci(Move m)
+{
+    std::string s = squareName(m.from()) + squareName(m.to());
+    if (m.kind()==Move::Promotion)
+        s += "nbrq"[m.promotion()];
+    return s;
+}
 
-    // handle en passant capture
-    if ((moving==WP || moving==BP) && QPoint(tr,tc)==m_enPassant) {
-        int capR = (moving==WP)?tr+1:tr-1;
-        m_board[capR*8+tc] = Empty;
+Move ChessBoard::parseUci(std::string_view uci) const
+{
+    if (uci.size()<4)
+        return Move();
+    const int from = parseSquare(uci.substr(0,2));
+    const int to = parseSquare(uci.substr(2,2));
+    if (from<0 || to<0)
+        return Move();
+    int promo = Move::Queen;
+    if (uci.size()>4) {
+        const std::size_t idx = std::string_view("nbrq").find(char(std::tolower(static_cast<unsigned char>(uci[4]))));
+        promo = idx==std::string_view::npos ? -1 : int(idx);
+    }
+    MoveList list;
+    legalMoves(from, list);
+    for (Move m : list) {
+        if (m.to()==to && (m.kind()!=Move::Promotion || m.promotion()==promo))
+            return m;
     }
+    return Move();
+}
 
-    m_board[ti] = moving;
-    m_board[fi] = Empty;
+static ChessBoard::Piece promotionPiece(ChessBoard::Color c, Move::PromotionPiece p)
+{
+    static constexpr std::array<ChessBoard::Piece, 4> white{{ChessBoard::WN, ChessBoard::WB, ChessBoard::WR, ChessBoard::WQ}};
+    static constexpr std::array<ChessBoard::Piece, 4> black{{ChessBoard::BN, ChessBoard::BB, ChessBoard::BR, ChessBoard::BQ}};
+    return (c==ChessBoard::White ? white : black)[p];
+}
 
-    // pawn promotion to queen
-    if (moving==WP && tr==0) m_board[ti] = WQ;
-    if (moving==BP && tr==7) m_board[ti] = BQ;
+// Castling rights that survive a move touching the given square.
+static constexpr std::array<int, 64> CastlingMask = [] {
+    std::array<int, 64> m{};
+    m.fill(ChessBoard::WhiteKingSide | ChessBoard::WhiteQueenSide
+           | ChessBoard::BlackKingSide | ChessBoard::BlackQueenSide);
+    m[0*8+0] &= ~ChessBoard::BlackQueenSide;
+    m[0*8+7] &= ~ChessBoard::BlackKingSide;
+    m[0*8+4] &= ~(ChessBoard::BlackKingSide | ChessBoard::BlackQueenSide);
+    m[7*8+0] &= ~ChessBoard::WhiteQueenSide;
+    m[7*8+7] &= ~ChessBoard::WhiteKingSide;
+    m[7*8+4] &= ~(ChessBoard::WhiteKingSide | ChessBoard::WhiteQueenSide);
+    return m;
+}();
 
-    // update castling rights
-    if (moving==WK) m_whiteKingMoved=true;
-    if (moving==BK) m_blackKingMoved=true;
-    if (fi==7*8+0) m_whiteLeftRookMoved=true;
-    if (fi==7*8+7) m_whiteRightRookMoved=true;
-    if (fi==0*8+0) m_blackLeftRookMoved=true;
-    if (fi==0*8+7) m_blackRightRookMoved=true;
+void ChessBoard::makeMove(Move m, Undo &undo)
+{
+    int from = m.from(), to = m.to();
+    Piece moving = m_board[from];
+    undo.captured = m_board[to];
+    undo.enPassant = static_cast<std::int8_t>(m_enPassant);
+    undo.castling = static_cast<std::uint8_t>(m_castling);
+    undo.rule50 = static_cast<std::uint16_t>(m_rule50);
+    m_keyHistory.push_back(m_key);
+    m_key ^= stateKey();
+
+    int row = to/8;
+    switch (m.kind()) {
+    case Move::Castling:
+        if (to>from) { // king side
+            putPiece(row*8+5, m_board[row*8+7]);
+            removePiece(row*8+7);
+        } else {
+            putPiece(row*8+3, m_board[row*8+0]);
+            removePiece(row*8+0);
+        }
+        break;
+    case Move::EnPassant: {
+        int capSq = (moving==WP)?to+8:to-8;
+        undo.captured = m_board[capSq];
+        removePiece(capSq);
+        break;
+    }
+    default:
+        break;
+    }
+
+    removePiece(from);
+    putPiece(to, moving);
+    if (m.kind()==Move::Promotion)
+        putPiece(to, promotionPiece(m_turn, m.promotion()));
+
+    m_castling &= CastlingMask[from] & CastlingMask[to];
 
     // set en passant target
-    m_enPassant = QPoint(-1,-1);
-    if ((moving==WP && fr==6 && tr==4) || (moving==BP && fr==1 && tr==3))
-        m_enPassant = QPoint((moving==WP)?5:2,tc);
+    bool pawn = (moving==WP || moving==BP);
+    m_enPassant = -1;
+    if (pawn && abs(to-from)==16)
+        m_enPassant = (from+to)/2;
 
+    m_rule50 = (pawn || undo.captured!=Empty) ? 0 : m_rule50+1;
+    ++m_gamePly;
     m_turn = (m_turn==White)?Black:White;
-    m_history.append(from+to);
-    return true;
+    m_key ^= stateKey();
+}
+
+void ChessBoard::unmakeMove(Move m, const Undo &undo)
+{
+    m_turn = (m_turn==White)?Black:White;
+    --m_gamePly;
+    m_rule50 = undo.rule50;
+    m_castling = undo.castling;
+    m_enPassant = undo.enPassant;
+
+    int from = m.from(), to = m.to();
+    Piece moving = (m.kind()==Move::Promotion) ? (m_turn==White?WP:BP) : m_board[to];
+    removePiece(to);
+    putPiece(from, moving);
+
+    switch (m.kind()) {
+    case Move::EnPassant:
+        putPiece((moving==WP)?to+8:to-8, undo.captured);
+        break;
+    case Move::Castling: {
+        putPiece(to, undo.captured);
+        int row = to/8;
+        if (to>from) {
+            putPiece(row*8+7, m_board[row*8+5]);
+            removePiece(row*8+5);
+        } else {
+            putPiece(row*8+0, m_board[row*8+3]);
+            removePiece(row*8+3);
+        }
+        break;
+    }
+    default:
+        putPiece(to, undo.captured);
+        break;
+    }
+
+    m_key = m_keyHistory.back();
+    m_keyHistory.pop_back();
+}
+
+void ChessBoard::makeNullMove(Undo &undo)
+{
+    undo.captured = Empty;
+    undo.enPassant = static_cast<std::int8_t>(m_enPassant);
+    undo.castling = static_cast<std::uint8_t>(m_castling);
+    undo.rule50 = static_cast<std::uint16_t>(m_rule50);
+    m_keyHistory.push_back(m_key);
+    m_key ^= stateKey();
+    m_enPassant = -1;
+    m_rule50 = 0;
+    ++m_gamePly;
+    m_turn = (m_turn==White)?Black:White;
+    m_key ^= stateKey();
+}
+
+void ChessBoard::unmakeNullMove(const Undo &undo)
+{
+    m_turn = (m_turn==White)?Black:White;
+    --m_gamePly;
+    m_rule50 = undo.rule50;
+    m_enPassant = undo.enPassant;
+    m_key = m_keyHistory.back();
+    m_keyHistory.pop_back();
 }
 
 ChessBoard::Color ChessBoard::pieceColor(Piece p) const
@@ -114,182 +366,166 @@ ChessBoard::Color ChessBoard::pieceColor(Piece p) const
     return White;
 }
 
-QVector<QPoint> ChessBoard::legalMoves(const QString &from) const
+ChessBoard::CheckInfo ChessBoard::checkInfo(Color c) const
 {
-    QVector<QPoint> res;
-    int r,c; strToPos(from,r,c);
-    Piece p = pieceAt(r,c);
-    if (p==Empty) return res;
+    using namespace Bitboards;
+    CheckInfo info;
+    Bitboard king = m_pieces[c==White?WK:BK];
+    if (!king)
+        return info;
+    info.king = lsb(king);
+    Color them = (c==White)?Black:White;
+    Bitboard occ = occupied();
+    info.checkers = attackersTo(info.king, occ) & m_colors[them];
+    if (popCount(info.checkers)==1)
+        info.checkMask = info.checkers | BetweenSquares[info.king][lsb(info.checkers)];
+    else if (info.checkers)
+        info.checkMask = 0;
+
+    Bitboard rooks = m_pieces[them==White?WR:BR] | m_pieces[them==White?WQ:BQ];
+    Bitboard bishops = m_pieces[them==White?WB:BB] | m_pieces[them==White?WQ:BQ];
+    Bitboard snipers = (rookAttacks(info.king, 0) & rooks) | (bishopAttacks(info.king, 0) & bishops);
+    while (snipers) {
+        Bitboard blockers = BetweenSquares[info.king][popLsb(snipers)] & occ;
+        if (popCount(blockers)==1)
+            info.pinned |= blockers & m_colors[c];
+    }
+    return info;
+}
+
+Bitboard ChessBoard::legalTargets(int sq) const
+{
+    Piece p = m_board[sq];
+    if (p==Empty) return 0;
+    return legalTargets(sq, checkInfo(pieceColor(p)));
+}
+
+Bitboard ChessBoard::legalTargets(int sq, const CheckInfo &info) const
+{
+    using namespace Bitboards;
+    Piece p = m_board[sq];
+    if (p==Empty) return 0;
     Color col = pieceColor(p);
-    auto add=[&](int rr,int cc){
-        if (rr<0||rr>=8||cc<0||cc>=8) return false;
-        Piece t = pieceAt(rr,cc);
-        if (t==Empty) { res.append(QPoint(rr,cc)); return true; }
-        if (pieceColor(t)!=col) { res.append(QPoint(rr,cc)); return false; }
-        return false;
-    };
+    Color them = (col==White)?Black:White;
+    Bitboard own = m_colors[col];
+    Bitboard occ = occupied();
 
-    if (p==WP || p==BP) {
-        int dir = (p==WP)?-1:1;
-        int startRow = (p==WP)?6:1;
-        if (pieceAt(r+dir,c)==Empty)
-            add(r+dir,c);
-        if (r==startRow && pieceAt(r+dir,c)==Empty && pieceAt(r+2*dir,c)==Empty)
-            add(r+2*dir,c);
-        if (c>0) {
-            Piece t = pieceAt(r+dir,c-1);
-            if (t!=Empty && pieceColor(t)!=col)
-                res.append(QPoint(r+dir,c-1));
+    if (p==WK || p==BK) {
+        Bitboard targets = 0;
+        // The king must not shield its own destination from a slider
+        Bitboard o = occ ^ squareBit(sq);
+        for (Bitboard b = KingAttacks[sq] & ~own; b; ) {
+            int to = popLsb(b);
+            if (!(attackersTo(to, o) & m_colors[them]))
+                targets |= squareBit(to);
+        }
+        // castling
+        if(!info.checkers && col==White && sq==7*8+4){
+            if((m_castling & WhiteKingSide) && pieceAt(7,5)==Empty && pieceAt(7,6)==Empty && !isSquareAttacked(7,5,Black) && !isSquareAttacked(7,6,Black))
+                targets |= squareBit(7*8+6);
+            if((m_castling & WhiteQueenSide) && pieceAt(7,3)==Empty && pieceAt(7,2)==Empty && pieceAt(7,1)==Empty && !isSquareAttacked(7,3,Black) && !isSquareAttacked(7,2,Black))
+                targets |= squareBit(7*8+2);
         }
-        if (c<7) {
-            Piece t = pieceAt(r+dir,c+1);
-            if (t!=Empty && pieceColor(t)!=col)
-                res.append(QPoint(r+dir,c+1));
+        if(!info.checkers && col==Black && sq==0*8+4){
+            if((m_castling & BlackKingSide) && pieceAt(0,5)==Empty && pieceAt(0,6)==Empty && !isSquareAttacked(0,5,White) && !isSquareAttacked(0,6,White))
+                targets |= squareBit(0*8+6);
+            if((m_castling & BlackQueenSide) && pieceAt(0,3)==Empty && pieceAt(0,2)==Empty && pieceAt(0,1)==Empty && !isSquareAttacked(0,3,White) && !isSquareAttacked(0,2,White))
+                targets |= squareBit(0*8+2);
         }
-        if (m_enPassant.x()!=-1 && r==m_enPassant.x()+((p==WP)?1:-1) && abs(c-m_enPassant.y())==1)
-            res.append(m_enPassant);
+        return targets;
     }
 
-    if (p==WN || p==BN) {
-        static const std::array<std::array<int,2>,8> d{{
-            {{-2,-1}},{{-2,1}},{{-1,-2}},{{-1,2}},{{1,-2}},{{1,2}},{{2,-1}},{{2,1}}
-        }};
-        std::for_each(d.begin(), d.end(), [&](const auto &o){ add(r+o[0], c+o[1]); });
+    // Only the king may move out of a double check
+    if (popCount(info.checkers)>1)
+        return 0;
+
+    Bitboard targets = 0;
+    switch (p) {
+    case WP: case BP: {
+        int dir = (p==WP)?-8:8;
+        int startRow = (p==WP)?6:1;
+        int one = sq+dir;
+        if (one>=0 && one<64 && !(occ & squareBit(one))) {
+            targets |= squareBit(one);
+            if (sq/8==startRow && !(occ & squareBit(one+dir)))
+                targets |= squareBit(one+dir);
+        }
+        targets |= PawnAttacks[col][sq] & m_colors[them];
+        break;
     }
-    if (p==WB || p==BB || p==WQ || p==BQ) {
-        static const std::array<std::array<int,2>,4> d{{ {{-1,-1}},{{-1,1}},{{1,-1}},{{1,1}} }};
-        std::for_each(d.begin(), d.end(), [&](const auto &o){
-            for(int rr=r+o[0], cc=c+o[1]; add(rr,cc); rr+=o[0], cc+=o[1]){}
-        });
-        if (p==WB || p==BB) {}
+    case WN: case BN:
+        targets = KnightAttacks[sq] & ~own;
+        break;
+    case WB: case BB:
+        targets = bishopAttacks(sq, occ) & ~own;
+        break;
+    case WR: case BR:
+        targets = rookAttacks(sq, occ) & ~own;
+        break;
+    case WQ: case BQ:
+        targets = queenAttacks(sq, occ) & ~own;
+        break;
+    default:
+        break;
     }
-    if (p==WR || p==BR || p==WQ || p==BQ) {
-        static const std::array<std::array<int,2>,4> d{{ {{-1,0}},{{1,0}},{{0,-1}},{{0,1}} }};
-        std::for_each(d.begin(), d.end(), [&](const auto &o){
-            for(int rr=r+o[0], cc=c+o[1]; add(rr,cc); rr+=o[0], cc+=o[1]){}
-        });
-        if (p==WR || p==BR) {}
-    }
-    if (p==WK || p==BK) {
-        static const std::array<std::array<int,2>,8> d{{
-            {{-1,-1}},{{-1,0}},{{-1,1}},{{0,-1}},{{0,1}},{{1,-1}},{{1,0}},{{1,1}}
-        }};
-        std::for_each(d.begin(), d.end(), [&](const auto &o){ add(r+o[0], c+o[1]); });
-        // castling
-        if(col==White && !m_whiteKingMoved){
-            if(!m_whiteRightRookMoved && pieceAt(7,5)==Empty && pieceAt(7,6)==Empty && !isSquareAttacked(7,4,Black) && !isSquareAttacked(7,5,Black) && !isSquareAttacked(7,6,Black))
-                res.append(QPoint(7,6));
-            if(!m_whiteLeftRookMoved && pieceAt(7,3)==Empty && pieceAt(7,2)==Empty && pieceAt(7,1)==Empty && !isSquareAttacked(7,4,Black) && !isSquareAttacked(7,3,Black) && !isSquareAttacked(7,2,Black))
-                res.append(QPoint(7,2));
-        }
-        if(col==Black && !m_blackKingMoved){
-            if(!m_blackRightRookMoved && pieceAt(0,5)==Empty && pieceAt(0,6)==Empty && !isSquareAttacked(0,4,White) && !isSquareAttacked(0,5,White) && !isSquareAttacked(0,6,White))
-                res.append(QPoint(0,6));
-            if(!m_blackLeftRookMoved && pieceAt(0,3)==Empty && pieceAt(0,2)==Empty && pieceAt(0,1)==Empty && !isSquareAttacked(0,4,White) && !isSquareAttacked(0,3,White) && !isSquareAttacked(0,2,White))
-                res.append(QPoint(0,2));
-        }
+
+    Bitboard allowed = info.checkMask;
+    if (info.pinned & squareBit(sq))
+        allowed &= LineSquares[info.king][sq];
+    targets &= allowed;
+
+    // En passant removes a pawn that is not on the target square, which can
+    // uncover a check along the rank; test it against the real occupancy.
+    if ((p==WP || p==BP) && m_enPassant!=-1 && (PawnAttacks[col][sq] & squareBit(m_enPassant))) {
+        int capSq = (p==WP)?m_enPassant+8:m_enPassant-8;
+        Bitboard o = (occ ^ squareBit(sq) ^ squareBit(capSq)) | squareBit(m_enPassant);
+        if (info.king<0 || !(attackersTo(info.king, o) & m_colors[them] & ~squareBit(capSq)))
+            targets |= squareBit(m_enPassant);
     }
+    return targets;
+}
 
-    QVector<QPoint> final;
-    std::copy_if(res.cbegin(), res.cend(), std::back_inserter(final), [&](const QPoint &m){
-        ChessBoard tmp = *this;
-        int fi=r*8+c;
-        int ti=m.x()*8+m.y();
-        tmp.m_board[ti]=tmp.m_board[fi];
-        tmp.m_board[fi]=Empty;
-        return !tmp.isInCheck(col);
-    });
-    return final;
+Bitboard ChessBoard::attackersTo(int sq, Bitboard occ) const
+{
+    using namespace Bitboards;
+    return (PawnAttacks[White][sq] & m_pieces[BP])
+         | (PawnAttacks[Black][sq] & m_pieces[WP])
+         | (KnightAttacks[sq] & (m_pieces[WN] | m_pieces[BN]))
+         | (KingAttacks[sq] & (m_pieces[WK] | m_pieces[BK]))
+         | (bishopAttacks(sq, occ) & (m_pieces[WB] | m_pieces[BB] | m_pieces[WQ] | m_pieces[BQ]))
+         | (rookAttacks(sq, occ) & (m_pieces[WR] | m_pieces[BR] | m_pieces[WQ] | m_pieces[BQ]));
 }
 
 bool ChessBoard::isSquareAttacked(int r,int c,Color by) const
 {
-    int dir = (by==White)?-1:1;
-    // pawn attacks
-    if(r-dir>=0 && r-dir<8){
-        if(c>0 && pieceAt(r-dir,c-1)==(by==White?WP:BP)) return true;
-        if(c<7 && pieceAt(r-dir,c+1)==(by==White?WP:BP)) return true;
-    }
-    // knight attacks
-    static const std::array<std::array<int,2>,8> nd{{
-        {{-2,-1}},{{-2,1}},{{-1,-2}},{{-1,2}},{{1,-2}},{{1,2}},{{2,-1}},{{2,1}}
-    }};
-    if(std::any_of(nd.begin(), nd.end(), [&](const auto &o){
-            int rr=r+o[0], cc=c+o[1];
-            return rr>=0&&rr<8&&cc>=0&&cc<8 && pieceAt(rr,cc)==(by==White?WN:BN);
-        }))
-        return true;
-    // bishop/queen attacks
-    static const std::array<std::array<int,2>,4> bd{{ {{-1,-1}},{{-1,1}},{{1,-1}},{{1,1}} }};
-    auto rayAttack = [&](int dr,int dc,const std::array<Piece,4> &pieces){
-        for(int rr=r+dr,cc=c+dc; rr>=0&&rr<8&&cc>=0&&cc<8; rr+=dr,cc+=dc){
-            Piece t=pieceAt(rr,cc);
-            if(t!=Empty){
-                if(pieceColor(t)==by && std::find(pieces.begin(), pieces.end(), t)!=pieces.end())
-                    return true;
-                break;
-            }
-        }
-        return false;
-    };
-    if(std::any_of(bd.begin(), bd.end(), [&](const auto &o){
-            return rayAttack(o[0], o[1], {BB,BQ,WB,WQ});
-        }))
-        return true;
-    // rook/queen attacks
-    static const std::array<std::array<int,2>,4> rd{{ {{-1,0}},{{1,0}},{{0,-1}},{{0,1}} }};
-    if(std::any_of(rd.begin(), rd.end(), [&](const auto &o){
-            return rayAttack(o[0], o[1], {BR,BQ,WR,WQ});
-        }))
-        return true;
-    // king attacks
-    static const std::array<std::array<int,2>,8> kd{{
-        {{-1,-1}},{{-1,0}},{{-1,1}},{{0,-1}},{{0,1}},{{1,-1}},{{1,0}},{{1,1}}
-    }};
-    if(std::any_of(kd.begin(), kd.end(), [&](const auto &o){
-            int rr=r+o[0], cc=c+o[1];
-            return rr>=0&&rr<8&&cc>=0&&cc<8 && pieceAt(rr,cc)==(by==White?WK:BK);
-        }))
-        return true;
-    return false;
+    return attackersTo(r*8+c, occupied()) & m_colors[by];
 }
 
 bool ChessBoard::isInCheck(Color c) const
 {
-    auto it = std::find_if(m_board.cbegin(), m_board.cend(), [&](Piece p){
-        return p == (c==White?WK:BK);
-    });
-    if(it == m_board.cend())
+    Bitboard king = m_pieces[c==White?WK:BK];
+    if(!king)
         return false;
-    int idx = std::distance(m_board.cbegin(), it);
-    int r = idx / 8;
-    int col = idx % 8;
-    return isSquareAttacked(r, col, c==White?Black:White);
+    return attackersTo(Bitboards::lsb(king), occupied()) & m_colors[c==White?Black:White];
 }
 
 bool ChessBoard::hasMoves(Color c) const
 {
-    int idx = 0;
-    // Check if any piece of color c has legal moves using std::any_of
-    return std::any_of(m_board.cbegin(), m_board.cend(), [&](Piece p) mutable {
-        int r = idx / 8;
-        int col = idx % 8;
-        ++idx;
-        if(p!=Empty && pieceColor(p)==c){
-            QString pos = QString("%1%2").arg(QChar('a'+col)).arg(8-r);
-            return !legalMoves(pos).isEmpty();
-        }
-        return false;
-    });
+    const CheckInfo info = checkInfo(c);
+    for (Bitboard b = m_colors[c]; b; ) {
+        if (legalTargets(Bitboards::popLsb(b), info))
+            return true;
+    }
+    return false;
 }
 
-QString ChessBoard::toFen() const
+std::string ChessBoard::toFen() const
 {
     static const std::array<char, 13> pieceChars{{
         '1','P','R','N','B','Q','K','p','r','n','b','q','k'
     }};
 
-    struct FenAcc { QString fen; int empty = 0; int idx = 0; };
+    struct FenAcc { std::string fen; int empty = 0; int idx = 0; };
 
     // Build the FEN string using std::accumulate with a lambda accumulator
     auto res = std::accumulate(m_board.begin(), m_board.end(), FenAcc{},
@@ -297,34 +533,125 @@ QString ChessBoard::toFen() const
             if(p==Empty){
                 ++a.empty;
             }else{
-                if(a.empty>0){ a.fen += QString::number(a.empty); a.empty = 0; }
+                if(a.empty>0){ a.fen += char('0'+a.empty); a.empty = 0; }
                 a.fen += pieceChars[static_cast<int>(p)];
             }
             ++a.idx;
             if(a.idx % 8 == 0){
-                if(a.empty>0){ a.fen += QString::number(a.empty); a.empty = 0; }
+                if(a.empty>0){ a.fen += char('0'+a.empty); a.empty = 0; }
                 if(a.idx != 64) a.fen += '/';
             }
             return a;
         });
 
-    QString fen = res.fen;
+    std::string fen = res.fen;
     fen+=' ';
     fen+=(m_turn==White?'w':'b');
     fen+=' ';
-    QString rights;
-    if(!m_whiteKingMoved && !m_whiteRightRookMoved) rights+="K";
-    if(!m_whiteKingMoved && !m_whiteLeftRookMoved) rights+="Q";
-    if(!m_blackKingMoved && !m_blackRightRookMoved) rights+="k";
-    if(!m_blackKingMoved && !m_blackLeftRookMoved) rights+="q";
-    if(rights.isEmpty()) rights="-";
+    std::string rights;
+    if(m_castling & WhiteKingSide) rights+="K";
+    if(m_castling & WhiteQueenSide) rights+="Q";
+    if(m_castling & BlackKingSide) rights+="k";
+    if(m_castling & BlackQueenSide) rights+="q";
+    if(rights.empty()) rights="-";
     fen+=rights;
     fen+=' ';
-    if(m_enPassant.x()!=-1)
-        fen+=posToStr(m_enPassant.x(),m_enPassant.y());
+    if(m_enPassant!=-1)
+        fen+=squareName(m_enPassant);
     else
         fen+="-";
-    fen+=" 0 ";
-    fen+=QString::number(m_history.size()/2 + 1);
+    fen+=' ';
+    fen+=std::to_string(m_rule50);
+    fen+=' ';
+    fen+=std::to_string(m_gamePly/2 + 1);
     return fen;
 }
+
+static int fenNumber(std::string_view field, int fallback)
+{
+    int n = 0;
+    for(char ch : field){
+        if(ch<'0' || ch>'9') return fallback;
+        n = n*10 + (ch-'0');
+    }
+    return field.empty() ? fallback : n;
+}
+
+bool ChessBoard::setFen(std::string_view fen)
+{
+    std::vector<std::string_view> fields;
+    for(std::size_t pos = 0; pos < fen.size(); ){
+        const std::size_t end = std::min(fen.find(' ', pos), fen.size());
+        if(end>pos) fields.push_back(fen.substr(pos, end-pos));
+        pos = end+1;
+    }
+    if(fields.size()<4)
+        return false;
+
+    Board board;
+    board.fill(Empty);
+    static constexpr std::string_view pieceChars = "PRNBQKprnbqk";
+    int r = 0, c = 0;
+    for(char ch : fields[0]){
+        if(ch=='/'){
+            if(c!=8) return false;
+            ++r; c = 0;
+        }else if(ch>='0' && ch<='9'){
+            c += ch-'0';
+        }else{
+            const std::size_t idx = pieceChars.find(ch);
+            if(idx==std::string_view::npos || r>7 || c>7) return false;
+            board[r*8+c] = static_cast<Piece>(WP+idx);
+            ++c;
+        }
+        if(c>8) return false;
+    }
+    if(r!=7 || c!=8)
+        return false;
+
+    if(fields[1]!="w" && fields[1]!="b")
+        return false;
+    const std::string_view rights = fields[2];
+    int ep = -1;
+    if(fields[3]!="-"){
+        ep = parseSquare(fields[3]);
+        if(ep<0) return false;
+    }
+    int rule50 = fields.size()>4 ? fenNumber(fields[4], 0) : 0;
+    int fullmove = fields.size()>5 ? fenNumber(fields[5], 1) : 1;
+
+    m_board.fill(Empty);
+    m_pieces.fill(0);
+    m_colors.fill(0);
+    m_key = 0;
+    for(int sq = 0; sq < 64; ++sq)
+        putPiece(sq, board[sq]);
+    m_turn = (fields[1]=="w")?White:Black;
+    m_history.clear();
+    m_keyHistory.clear();
+    m_gamePly = std::max(fullmove-1,0)*2 + (m_turn==Black?1:0);
+    m_rule50 = std::max(rule50,0);
+    // Drop rights whose king or rook is not on its home square
+    m_castling = 0;
+    if(rights.find('K')!=rights.npos && board[7*8+4]==WK && board[7*8+7]==WR) m_castling |= WhiteKingSide;
+    if(rights.find('Q')!=rights.npos && board[7*8+4]==WK && board[7*8+0]==WR) m_castling |= WhiteQueenSide;
+    if(rights.find('k')!=rights.npos && board[0*8+4]==BK && board[0*8+7]==BR) m_castling |= BlackKingSide;
+    if(rights.find('q')!=rights.npos && board[0*8+4]==BK && board[0*8+0]==BR) m_castling |= BlackQueenSide;
+    m_enPassant = ep;
+    m_key ^= stateKey();
+    m_startFen = toFen();
+    return true;
+}
+
+std::string ChessBoard::uciPosition() const
+{
+    std::string cmd = m_startFen.empty() ? std::string("position startpos") : "position fen " + m_startFen;
+    if(!m_history.empty()){
+        cmd += " moves";
+        for(const std::string &m : m_history){
+            cmd += ' ';
+            cmd += m;
+        }
+    }
+    return cmd;
+}
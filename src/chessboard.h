@@ -2,42 +2,126 @@
 #define CHESSBOARD_H
 
 #include <array>
-#include <QString>
-#include <QVector>
-#include <QPoint>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bitboard.h"
+#include "move.h"
 
+// Rules, move generation and FEN for one game. Standard library only, so it
+// builds into chesscore for headless tools without Qt.
 class ChessBoard
 {
 public:
     enum Color { White, Black };
     enum Piece { Empty, WP, WR, WN, WB, WQ, WK, BP, BR, BN, BB, BQ, BK };
+    enum CastlingRight { WhiteKingSide = 1, WhiteQueenSide = 2, BlackKingSide = 4, BlackQueenSide = 8 };
+
+    // State that makeMove cannot recompute on the way back. Squares are
+    // row*8+col indices, -1 meaning none.
+    struct Undo
+    {
+        Piece captured = Empty;
+        std::int8_t enPassant = -1;
+        std::uint8_t castling = 0;
+        std::uint16_t rule50 = 0;
+    };
 
     ChessBoard();
     void reset();
-    bool move(const QString &from, const QString &to);
-    QVector<QPoint> legalMoves(const QString &from) const;
+    // Squares by name, e.g. move("e2", "e4")
+    bool move(std::string_view from, std::string_view to);
+
+    // Square-index API; squares are row*8+col with a8=0. A pawn reaching the
+    // last rank promotes to a queen unless another piece is given.
+    bool move(int from, int to, Piece promotion = Empty);
+    bool move(Move m);
+    void legalMoves(MoveList &list) const;
+    void legalMoves(int from, MoveList &list) const;
+    Move parseUci(std::string_view uci) const;
+    static std::string toUci(Move m);
+    // "a8".."h1" to a square index and back; -1 for anything else
+    static int parseSquare(std::string_view name);
+    static std::string squareName(int sq);
+
     bool isInCheck(Color c) const;
     bool hasMoves(Color c) const;
     Piece pieceAt(int row, int col) const { return m_board[row*8+col]; }
+    Piece pieceAt(int sq) const { return m_board[sq]; }
     Color currentColor() const { return m_turn; }
     Color pieceColor(Piece p) const;
-    QVector<QString> history() const { return m_history; }
-    QString toFen() const;
+    // Moves made through move(), in UCI notation
+    const std::vector<std::string> &history() const { return m_history; }
+    std::string toFen() const;
+    bool setFen(std::string_view fen);
+    // UCI "position" command for the game so far: the starting position and
+    // every move since, so an engine sees repetitions and the 50-move count.
+    std::string uciPosition() const;
+
+    // In-place move application for search and validation. makeMove expects
+    // a legal move and leaves history() untouched; unmakeMove must be given
+    // the same move and the Undo filled by makeMove.
+    void makeMove(Move m, Undo &undo);
+    void unmakeMove(Move m, const Undo &undo);
+    // Passes the turn, for null-move pruning. Repetitions are not looked up
+    // across a null move.
+    void makeNullMove(Undo &undo);
+    void unmakeNullMove(const Undo &undo);
+
+    // Checkers and pinned pieces of one side, computed once per position so
+    // every piece's legal targets come from masks instead of trial moves.
+    struct CheckInfo
+    {
+        int king = -1;
+        Bitboard checkers = 0;
+        Bitboard checkMask = ~Bitboard(0); // squares that block or capture a single checker
+        Bitboard pinned = 0;
+    };
+    CheckInfo checkInfo(Color c) const;
+    Bitboard legalTargets(int sq) const;
+    Bitboard legalTargets(int sq, const CheckInfo &info) const;
+    Bitboard colorMask(Color c) const { return m_colors[c]; }
+    Bitboard pieceMask(Piece p) const { return m_pieces[p]; }
+    int halfmoveClock() const { return m_rule50; }
+    int castlingRights() const { return m_castling; }
+    // Square a pawn may capture en passant onto, -1 if none
+    int enPassantSquare() const { return m_enPassant; }
+
+    // Zobrist key of the position, maintained incrementally by every move
+    std::uint64_t key() const { return m_key; }
+    // Earlier occurrences of the current position since the last capture or
+    // pawn move; 2 means the position is on the board for the third time.
+    int repetitions() const;
+    bool isThreefoldRepetition() const { return repetitions()>=2; }
+    // Neither side can mate: bare kings, a single minor piece, or bishops
+    // that all stand on squares of one colour
+    bool isInsufficientMaterial() const;
 
 private:
     using Board = std::array<Piece, 64>;
     Board m_board;
+    // One mask per Piece value (index Empty is unused) plus per-color unions,
+    // kept in sync with m_board by putPiece/removePiece.
+    std::array<Bitboard, 13> m_pieces{};
+    std::array<Bitboard, 2> m_colors{};
     Color m_turn = White;
-    QVector<QString> m_history;
-    bool m_whiteKingMoved = false;
-    bool m_blackKingMoved = false;
-    bool m_whiteLeftRookMoved = false;
-    bool m_whiteRightRookMoved = false;
-    bool m_blackLeftRookMoved = false;
-    bool m_blackRightRookMoved = false;
-    QPoint m_enPassant{-1,-1};
+    std::vector<std::string> m_history;
+    std::string m_startFen; // empty when the game began from the initial position
+    int m_castling = WhiteKingSide | WhiteQueenSide | BlackKingSide | BlackQueenSide;
+    int m_enPassant = -1;
+    int m_rule50 = 0;
+    int m_gamePly = 0;
+    std::uint64_t m_key = 0;
+    std::vector<std::uint64_t> m_keyHistory; // keys before each move made
 
     bool isSquareAttacked(int r,int c,Color by) const;
+    Bitboard attackersTo(int sq, Bitboard occ) const;
+    void addMoves(int from, Bitboard targets, MoveList &list) const;
+    void putPiece(int sq, Piece p);
+    void removePiece(int sq);
+    std::uint64_t stateKey() const;
+    Bitboard occupied() const { return m_colors[White] | m_colors[Black]; }
 };
 
 #endif // CHESSBOARD_H
@@ -0,0 +1,53 @@
+#include "evalbar.h"
+#include <QPainter>
+#include <cmath>
+
+EvalBar::EvalBar(QWidget *parent)
+    : QWidget(parent)
+{
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+}
+
+void EvalBar::setScore(int centipawns)
+{
+    // Logistic curve: a pawn up is about two thirds of the bar
+    m_white = 1.0 / (1.0 + std::pow(10.0, -centipawns / 400.0));
+    m_text = QString::asprintf("%+.1f", centipawns / 100.0);
+    update();
+}
+
+void EvalBar::setMate(int moves)
+{
+    m_white = moves>0 ? 1.0 : 0.0;
+    m_text = "M" + QString::number(std::abs(moves));
+    update();
+}
+
+void EvalBar::clear()
+{
+    m_white = 0.5;
+    m_text.clear();
+    update();
+}
+
+void EvalBar::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    const QRect r = rect();
+    const int whiteHeight = int(std::lround(r.height() * m_white));
+    QRect white = r, black = r;
+    white.setTop(r.bottom() - whiteHeight + 1);
+    black.setBottom(r.bottom() - whiteHeight);
+    p.fillRect(black, QColor(64, 64, 64));
+    p.fillRect(white, QColor(240, 240, 240));
+    if (m_text.isEmpty())
+        return;
+
+    // Label sits at the leading side's end of the bar
+    QFont font = p.font();
+    font.setPointSizeF(font.pointSizeF() * 0.75);
+    p.setFont(font);
+    const bool whiteAhead = m_white>=0.5;
+    p.setPen(whiteAhead ? Qt::black : Qt::white);
+    p.drawText(r.adjusted(0, 2, 0, -2), Qt::AlignHCenter | (whiteAhead ? Qt::AlignBottom : Qt::AlignTop), m_text);
+}
@@ -0,0 +1,29 @@
+#ifndef EVALBAR_H
+#define EVALBAR_H
+
+#include <QWidget>
+
+// Vertical bar showing the engine's assessment as White's share of the
+// height, White at the bottom like the board.
+class EvalBar : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit EvalBar(QWidget *parent = nullptr);
+
+    // Scores are from White's point of view
+    void setScore(int centipawns);
+    void setMate(int moves);
+    void clear();
+
+    QSize sizeHint() const override { return QSize(24, 400); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    double m_white = 0.5; // fraction of the bar that is White's
+    QString m_text;
+};
+
+#endif // EVALBAR_H
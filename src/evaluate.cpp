@@ -0,0 +1,164 @@
+#include "evaluate.h"
+#include <array>
+
+namespace Evaluation {
+
+namespace {
+
+using Table = std::array<int, 64>;
+
+// Tables are laid out from White's point of view with rank 8 first, which
+// is ChessBoard's square order; Black looks them up mirrored (sq ^ 56).
+constexpr Table PawnTable{{
+      0,  0,  0,  0,  0,  0,  0,  0,
+     50, 50, 50, 50, 50, 50, 50, 50,
+     10, 10, 20, 30, 30, 20, 10, 10,
+      5,  5, 10, 25, 25, 10,  5,  5,
+      0,  0,  0, 20, 20,  0,  0,  0,
+      5, -5,-10,  0,  0,-10, -5,  5,
+      5, 10, 10,-20,-20, 10, 10,  5,
+      0,  0,  0,  0,  0,  0,  0,  0
+}};
+
+constexpr Table KnightTable{{
+    -50,-40,-30,-30,-30,-30,-40,-50,
+    -40,-20,  0,  0,  0,  0,-20,-40,
+    -30,  0, 10, 15, 15, 10,  0,-30,
+    -30,  5, 15, 20, 20, 15,  5,-30,
+    -30,  0, 15, 20, 20, 15,  0,-30,
+    -30,  5, 10, 15, 15, 10,  5,-30,
+    -40,-20,  0,  5,  5,  0,-20,-40,
+    -50,-40,-30,-30,-30,-30,-40,-50
+}};
+
+constexpr Table BishopTable{{
+    -20,-10,-10,-10,-10,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5, 10, 10,  5,  0,-10,
+    -10,  5,  5, 10, 10,  5,  5,-10,
+    -10,  0, 10, 10, 10, 10,  0,-10,
+    -10, 10, 10, 10, 10, 10, 10,-10,
+    -10,  5,  0,  0,  0,  0,  5,-10,
+    -20,-10,-10,-10,-10,-10,-10,-20
+}};
+
+constexpr Table RookTable{{
+      0,  0,  0,  0,  0,  0,  0,  0,
+      5, 10, 10, 10, 10, 10, 10,  5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+      0,  0,  0,  5,  5,  0,  0,  0
+}};
+
+constexpr Table QueenTable{{
+    -20,-10,-10, -5, -5,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5,  5,  5,  5,  0,-10,
+     -5,  0,  5,  5,  5,  5,  0, -5,
+      0,  0,  5,  5,  5,  5,  0, -5,
+    -10,  5,  5,  5,  5,  5,  0,-10,
+    -10,  0,  5,  0,  0,  0,  0,-10,
+    -20,-10,-10, -5, -5,-10,-10,-20
+}};
+
+constexpr Table KingMiddleTable{{
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -20,-30,-30,-40,-40,-30,-30,-20,
+    -10,-20,-20,-20,-20,-20,-20,-10,
+     20, 20,  0,  0,  0,  0, 20, 20,
+     20, 30, 10,  0,  0, 10, 30, 20
+}};
+
+constexpr Table KingEndTable{{
+    -50,-40,-30,-20,-20,-30,-40,-50,
+    -30,-20,-10,  0,  0,-10,-20,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-30,  0,  0,  0,  0,-30,-30,
+    -50,-30,-30,-30,-30,-30,-30,-50
+}};
+
+struct PieceTerms
+{
+    ChessBoard::Piece white;
+    ChessBoard::Piece black;
+    int value;
+    int phase;
+    const Table *table;
+};
+
+constexpr std::array<PieceTerms, 5> Terms{{
+    {ChessBoard::WP, ChessBoard::BP, PawnValue, 0, &PawnTable},
+    {ChessBoard::WN, ChessBoard::BN, KnightValue, 1, &KnightTable},
+    {ChessBoard::WB, ChessBoard::BB, BishopValue, 1, &BishopTable},
+    {ChessBoard::WR, ChessBoard::BR, RookValue, 2, &RookTable},
+    {ChessBoard::WQ, ChessBoard::BQ, QueenValue, 4, &QueenTable},
+}};
+
+} // namespace
+
+int pieceValue(ChessBoard::Piece p)
+{
+    static constexpr std::array<int, 13> values{{
+        0, PawnValue, RookValue, KnightValue, BishopValue, QueenValue, 0,
+        PawnValue, RookValue, KnightValue, BishopValue, QueenValue, 0
+    }};
+    return values[p];
+}
+
+int pieceSquareValue(ChessBoard::Piece p, int sq)
+{
+    for (const PieceTerms &t : Terms)
+        if (t.white==p)
+            return t.value + (*t.table)[sq];
+    return 0;
+}
+
+int piecePhase(ChessBoard::Piece p)
+{
+    for (const PieceTerms &t : Terms)
+        if (t.white==p || t.black==p)
+            return t.phase;
+    return 0;
+}
+
+int kingSquareValue(int sq, int phase)
+{
+    return (KingMiddleTable[sq]*phase + KingEndTable[sq]*(MaxPhase-phase)) / MaxPhase;
+}
+
+int evaluate(const ChessBoard &board)
+{
+    int score = 0;
+    int phase = 0;
+    for (const PieceTerms &t : Terms) {
+        for (Bitboard b = board.pieceMask(t.white); b; ) {
+            score += t.value + (*t.table)[Bitboards::popLsb(b)];
+            phase += t.phase;
+        }
+        for (Bitboard b = board.pieceMask(t.black); b; ) {
+            score -= t.value + (*t.table)[Bitboards::popLsb(b) ^ 56];
+            phase += t.phase;
+        }
+    }
+
+    if (phase > MaxPhase)
+        phase = MaxPhase;
+    Bitboard wk = board.pieceMask(ChessBoard::WK);
+    Bitboard bk = board.pieceMask(ChessBoard::BK);
+    if (wk)
+        score += kingSquareValue(Bitboards::lsb(wk), phase);
+    if (bk)
+        score -= kingSquareValue(Bitboards::lsb(bk) ^ 56, phase);
+    return board.currentColor()==ChessBoard::White ? score : -score;
+}
+
+} // namespace Evaluation
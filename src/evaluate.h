@@ -0,0 +1,34 @@
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include "chessboard.h"
+
+namespace Evaluation {
+
+constexpr int PawnValue = 100;
+constexpr int KnightValue = 320;
+constexpr int BishopValue = 330;
+constexpr int RookValue = 500;
+constexpr int QueenValue = 900;
+// Game phase of the starting material; evaluate() clamps at it
+constexpr int MaxPhase = 24;
+
+// Material value of a piece of either color; kings and Empty are 0
+int pieceValue(ChessBoard::Piece p);
+// Material plus table bonus of a white non-king piece on sq; Black uses
+// the mirrored square (sq ^ 56)
+int pieceSquareValue(ChessBoard::Piece p, int sq);
+// Share of a piece of either color in the game phase: 1 for knights and
+// bishops, 2 for rooks, 4 for queens, 0 otherwise
+int piecePhase(ChessBoard::Piece p);
+// King table bonus on sq at the given phase, from White's point of view
+int kingSquareValue(int sq, int phase);
+
+// Static evaluation in centipawns from the side to move's point of view:
+// material plus piece-square tables, with the king table blended between
+// middlegame and endgame by the remaining non-pawn material.
+int evaluate(const ChessBoard &board);
+
+} // namespace Evaluation
+
+#endif // EVALUATE_H
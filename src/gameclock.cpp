@@ -0,0 +1,87 @@
+#include "gameclock.h"
+#include <algorithm>
+
+GameClock::GameClock(QObject *parent)
+    : QObject(parent)
+{
+    m_flagTimer.setSingleShot(true);
+    m_flagTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_flagTimer, &QTimer::timeout, this, [this] {
+        if (!m_running)
+            return;
+        if (remaining(m_side)<=0) {
+            stop();
+            emit flagFell(m_side);
+        } else {
+            armFlag();
+        }
+    });
+}
+
+void GameClock::reset(const TimeControl &tc)
+{
+    stop();
+    m_tc = tc;
+    m_remaining[ChessBoard::White] = tc.base;
+    m_remaining[ChessBoard::Black] = tc.base;
+}
+
+void GameClock::start(ChessBoard::Color sideToMove)
+{
+    m_side = sideToMove;
+    m_running = true;
+    m_turn.start();
+    armFlag();
+}
+
+void GameClock::stop()
+{
+    if (!m_running)
+        return;
+    m_remaining[m_side] -= used();
+    m_running = false;
+    m_flagTimer.stop();
+}
+
+void GameClock::switchTo(ChessBoard::Color c)
+{
+    if (!m_running || c==m_side)
+        return;
+    m_remaining[m_side] -= used();
+    if (m_remaining[m_side]>0)
+        m_remaining[m_side] += m_tc.increment;
+    m_side = c;
+    m_turn.start();
+    armFlag();
+}
+
+// Time of the running turn that counts against the clock
+qint64 GameClock::used() const
+{
+    return std::max<qint64>(0, m_turn.elapsed() - m_tc.delay);
+}
+
+qint64 GameClock::remaining(ChessBoard::Color c) const
+{
+    qint64 ms = m_remaining[c];
+    if (m_running && c==m_side)
+        ms -= used();
+    return std::max<qint64>(0, ms);
+}
+
+// Wakes up when the side to move would run out, not on every tick
+void GameClock::armFlag()
+{
+    qint64 left = m_remaining[m_side] - used();
+    qint64 untilFlag = left + std::max<qint64>(0, m_tc.delay - m_turn.elapsed());
+    m_flagTimer.start(int(std::clamp<qint64>(untilFlag, 0, 1 << 30)));
+}
+
+// m:ss, with tenths once under ten seconds
+QString GameClock::format(qint64 ms)
+{
+    if (ms<10000)
+        return QString("%1:%2.%3").arg(ms/60000,2,10,QChar('0')).arg(ms/1000%60,2,10,QChar('0')).arg(ms/100%10);
+    qint64 s = ms/1000;
+    return QString("%1:%2").arg(s/60,2,10,QChar('0')).arg(s%60,2,10,QChar('0'));
+}
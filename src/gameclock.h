@@ -0,0 +1,57 @@
+#ifndef GAMECLOCK_H
+#define GAMECLOCK_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+#include "chessboard.h"
+
+// Chess clock with millisecond resolution on a monotonic timer. Time is
+// charged only when the turn changes hands (or the clock stops), from the
+// moment the turn began, so display refreshes never affect the result.
+class GameClock : public QObject
+{
+    Q_OBJECT
+public:
+    // All values in milliseconds. With a delay the clock of the side to
+    // move only starts running once that much of its turn has passed.
+    struct TimeControl
+    {
+        qint64 base = 600000;
+        qint64 increment = 0;
+        qint64 delay = 0;
+    };
+
+    explicit GameClock(QObject *parent = nullptr);
+
+    void reset(const TimeControl &tc);
+    void start(ChessBoard::Color sideToMove);
+    void stop();
+    // Ends the turn of the side to move when c differs from it: charges the
+    // time used, adds the increment and starts c's turn.
+    void switchTo(ChessBoard::Color c);
+
+    qint64 remaining(ChessBoard::Color c) const;
+    ChessBoard::Color sideToMove() const { return m_side; }
+    bool isRunning() const { return m_running; }
+    const TimeControl &timeControl() const { return m_tc; }
+
+    static QString format(qint64 ms);
+
+signals:
+    void flagFell(ChessBoard::Color c);
+
+private:
+    qint64 used() const;
+    void armFlag();
+
+    TimeControl m_tc;
+    qint64 m_remaining[2] = {0, 0};
+    ChessBoard::Color m_side = ChessBoard::White;
+    bool m_running = false;
+    QElapsedTimer m_turn;
+    QTimer m_flagTimer;
+};
+
+#endif // GAMECLOCK_H
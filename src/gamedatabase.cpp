@@ -0,0 +1,351 @@
+#include "gamedatabase.h"
+#include "chessboard.h"
+#include "trace.h"
+#include <QSqlError>
+#include <QVariant>
+
+namespace {
+
+// Columns id, white, black, result, termination, time_control, started, plies
+GameSummary readSummary(const QSqlQuery &query)
+{
+    GameSummary g;
+    g.id = query.value(0).toLongLong();
+    g.white = query.value(1).toString();
+    g.black = query.value(2).toString();
+    g.result = query.value(3).toString();
+    g.termination = query.value(4).toString();
+    g.timeControl = query.value(5).toString();
+    g.started = query.value(6).toLongLong();
+    g.plies = query.value(7).toInt();
+    return g;
+}
+
+} // namespace
+
+bool GameDatabase::open(const QString &path, const QString &connectionName)
+{
+    close();
+    m_connection = connectionName;
+    m_db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    m_db.setDatabaseName(path);
+    if (!m_db.open()) {
+        m_error = m_db.lastError().text();
+        return false;
+    }
+
+    // WAL lets the UI's connection read while this one writes; with WAL,
+    // NORMAL sync only loses the last transactions on power failure, never
+    // consistency
+    const char *setup[] = {
+        "PRAGMA journal_mode=WAL",
+        "PRAGMA synchronous=NORMAL",
+        "PRAGMA foreign_keys=ON",
+        // Position keys are random, so index inserts land all over the
+        // table; a larger page cache keeps them off the disk
+        "PRAGMA cache_size=-65536",
+        "CREATE TABLE IF NOT EXISTS games("
+        " id INTEGER PRIMARY KEY,"
+        " white TEXT, black TEXT, result TEXT, termination TEXT,"
+        " time_control TEXT, start_fen TEXT,"
+        " started INTEGER, finished INTEGER, plies INTEGER DEFAULT 0)",
+        "CREATE TABLE IF NOT EXISTS moves("
+        " game_id INTEGER REFERENCES games(id) ON DELETE CASCADE,"
+        " ply INTEGER, uci TEXT, clock INTEGER,"
+        " PRIMARY KEY(game_id, ply)) WITHOUT ROWID",
+        "CREATE INDEX IF NOT EXISTS games_white ON games(white, started)",
+        "CREATE INDEX IF NOT EXISTS games_black ON games(black, started)",
+        // One row per position of every game, clustered by key; keys are
+        // stored as the same 64 bits read as signed. move is the move
+        // played from the position, result is copied from the game so the
+        // statistics need no join.
+        "CREATE TABLE IF NOT EXISTS positions("
+        " key INTEGER, game_id INTEGER, ply INTEGER, move TEXT, result TEXT,"
+        " PRIMARY KEY(key, game_id, ply)) WITHOUT ROWID",
+        // Move statistics per position, kept up to date as games are
+        // indexed so reading them costs a few rows however often the
+        // position was played. move is '' for games that ended there.
+        "CREATE TABLE IF NOT EXISTS position_moves("
+        " key INTEGER, move TEXT, count INTEGER, w INTEGER, d INTEGER, l INTEGER,"
+        " PRIMARY KEY(key, move)) WITHOUT ROWID",
+        // Databases indexed before the table existed fill it once
+        "INSERT INTO position_moves(key, move, count, w, d, l)"
+        " SELECT key, IFNULL(move, ''), COUNT(*), SUM(result='1-0'), SUM(result='1/2-1/2'), SUM(result='0-1')"
+        " FROM positions WHERE NOT EXISTS (SELECT 1 FROM position_moves)"
+        " GROUP BY key, IFNULL(move, '')",
+    };
+    QSqlQuery query(m_db);
+    for (const char *sql : setup) {
+        if (!query.exec(sql)) {
+            m_error = query.lastError().text();
+            return false;
+        }
+    }
+
+    m_insertGame = QSqlQuery(m_db);
+    m_insertMove = QSqlQuery(m_db);
+    m_finishGame = QSqlQuery(m_db);
+    m_selectGames = QSqlQuery(m_db);
+    m_selectMoves = QSqlQuery(m_db);
+    m_selectStart = QSqlQuery(m_db);
+    m_insertPosition = QSqlQuery(m_db);
+    m_countMove = QSqlQuery(m_db);
+    m_positionMoves = QSqlQuery(m_db);
+    m_positionGames = QSqlQuery(m_db);
+    m_savepoint = QSqlQuery(m_db);
+    m_release = QSqlQuery(m_db);
+    m_rollbackTo = QSqlQuery(m_db);
+    const bool prepared =
+        m_insertGame.prepare("INSERT INTO games(white, black, result, termination, time_control, start_fen,"
+                             " started, finished, plies) VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)")
+        && m_insertMove.prepare("INSERT OR REPLACE INTO moves(game_id, ply, uci, clock) VALUES(?, ?, ?, ?)")
+        && m_finishGame.prepare("UPDATE games SET result=?, termination=?, finished=?,"
+                                " plies=(SELECT COUNT(*) FROM moves WHERE game_id=?) WHERE id=?")
+        && m_selectGames.prepare("SELECT id, white, black, result, termination, time_control, started, plies"
+                                 " FROM games WHERE ?='' OR white=? OR black=? ORDER BY started DESC LIMIT ?")
+        && m_selectMoves.prepare("SELECT uci, clock FROM moves WHERE game_id=? ORDER BY ply")
+        && m_selectStart.prepare("SELECT start_fen FROM games WHERE id=?")
+        && m_insertPosition.prepare("INSERT OR IGNORE INTO positions(key, game_id, ply, move, result)"
+                                    " VALUES(?, ?, ?, ?, ?)")
+        && m_countMove.prepare("INSERT INTO position_moves(key, move, count, w, d, l) VALUES(?, ?, 1, ?, ?, ?)"
+                               " ON CONFLICT(key, move) DO UPDATE SET count=count+1,"
+                               " w=w+excluded.w, d=d+excluded.d, l=l+excluded.l")
+        && m_positionMoves.prepare("SELECT move, count, w, d, l FROM position_moves WHERE key=?"
+                                   " ORDER BY count DESC")
+        && m_positionGames.prepare("SELECT id, white, black, result, termination, time_control, started, plies"
+                                   " FROM games WHERE id IN (SELECT DISTINCT game_id FROM positions"
+                                   " WHERE key=? ORDER BY game_id DESC LIMIT ?) ORDER BY id DESC")
+        && m_savepoint.prepare("SAVEPOINT write")
+        && m_release.prepare("RELEASE write")
+        && m_rollbackTo.prepare("ROLLBACK TO write");
+    if (!prepared) {
+        m_error = m_db.lastError().text();
+        return false;
+    }
+    // Reads only move forward, which saves SQLite buffering results
+    m_selectGames.setForwardOnly(true);
+    m_selectMoves.setForwardOnly(true);
+    m_selectStart.setForwardOnly(true);
+    m_positionMoves.setForwardOnly(true);
+    m_positionGames.setForwardOnly(true);
+    return true;
+}
+
+void GameDatabase::close()
+{
+    if (m_connection.isEmpty())
+        return;
+    // Queries must go before the connection can be removed
+    m_insertGame = QSqlQuery();
+    m_insertMove = QSqlQuery();
+    m_finishGame = QSqlQuery();
+    m_selectGames = QSqlQuery();
+    m_selectMoves = QSqlQuery();
+    m_selectStart = QSqlQuery();
+    m_insertPosition = QSqlQuery();
+    m_countMove = QSqlQuery();
+    m_positionMoves = QSqlQuery();
+    m_positionGames = QSqlQuery();
+    m_savepoint = QSqlQuery();
+    m_release = QSqlQuery();
+    m_rollbackTo = QSqlQuery();
+    m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_connection);
+    m_connection.clear();
+}
+
+bool GameDatabase::exec(QSqlQuery &query)
+{
+    TRACE_SCOPE("GameDatabase::exec");
+    if (query.exec())
+        return true;
+    m_error = query.lastError().text();
+    return false;
+}
+
+bool GameDatabase::begin()
+{
+    if (m_db.transaction())
+        return true;
+    m_error = m_db.lastError().text();
+    return false;
+}
+
+bool GameDatabase::commit()
+{
+    if (m_db.commit())
+        return true;
+    m_error = m_db.lastError().text();
+    m_db.rollback();
+    return false;
+}
+
+void GameDatabase::rollback()
+{
+    m_db.rollback();
+}
+
+bool GameDatabase::beginWrite()
+{
+    return exec(m_savepoint);
+}
+
+bool GameDatabase::commitWrite()
+{
+    return exec(m_release);
+}
+
+void GameDatabase::rollbackWrite()
+{
+    // ROLLBACK TO keeps the savepoint open
+    m_rollbackTo.exec();
+    m_release.exec();
+}
+
+qint64 GameDatabase::addGame(const GameRecord &game)
+{
+    m_insertGame.bindValue(0, game.white);
+    m_insertGame.bindValue(1, game.black);
+    m_insertGame.bindValue(2, game.result);
+    m_insertGame.bindValue(3, game.termination);
+    m_insertGame.bindValue(4, game.timeControl);
+    m_insertGame.bindValue(5, game.startFen);
+    m_insertGame.bindValue(6, game.started);
+    m_insertGame.bindValue(7, game.finished);
+    m_insertGame.bindValue(8, int(game.moves.size()));
+    if (!exec(m_insertGame))
+        return 0;
+    const qint64 id = m_insertGame.lastInsertId().toLongLong();
+    for (int i = 0; i < game.moves.size(); ++i)
+        if (!addMove(id, i + 1, game.moves[i]))
+            return 0;
+    if (!game.moves.isEmpty() && !indexGame(id, game.startFen, game.result, game.moves, game.keys))
+        return 0;
+    return id;
+}
+
+bool GameDatabase::addMove(qint64 game, int ply, const StoredMove &move)
+{
+    m_insertMove.bindValue(0, game);
+    m_insertMove.bindValue(1, ply);
+    m_insertMove.bindValue(2, move.uci);
+    m_insertMove.bindValue(3, move.clock);
+    return exec(m_insertMove);
+}
+
+bool GameDatabase::finishGame(qint64 game, const QString &result, const QString &termination, qint64 finished)
+{
+    m_finishGame.bindValue(0, result);
+    m_finishGame.bindValue(1, termination);
+    m_finishGame.bindValue(2, finished);
+    m_finishGame.bindValue(3, game);
+    m_finishGame.bindValue(4, game);
+    if (!exec(m_finishGame))
+        return false;
+
+    m_selectStart.bindValue(0, game);
+    if (!exec(m_selectStart))
+        return false;
+    const QString startFen = m_selectStart.next() ? m_selectStart.value(0).toString() : QString();
+    m_selectStart.finish();
+    return indexGame(game, startFen, result, moves(game), {});
+}
+
+bool GameDatabase::indexGame(qint64 game, const QString &startFen, const QString &result,
+                             const QVector<StoredMove> &moves, QVector<quint64> keys)
+{
+    if (keys.size()!=moves.size() + 1) {
+        keys.clear();
+        ChessBoard board;
+        if (!startFen.isEmpty() && !board.setFen(startFen.toStdString()))
+            return true; // nothing sensible to index
+        keys.append(board.key());
+        for (const StoredMove &m : moves) {
+            const Move move = board.parseUci(m.uci.toStdString());
+            if (move.isNull())
+                break;
+            ChessBoard::Undo undo;
+            board.makeMove(move, undo);
+            keys.append(board.key());
+        }
+    }
+    for (int ply = 0; ply < keys.size(); ++ply) {
+        const QString move = ply < moves.size() ? moves[ply].uci : QString();
+        m_insertPosition.bindValue(0, qint64(keys[ply]));
+        m_insertPosition.bindValue(1, game);
+        m_insertPosition.bindValue(2, ply);
+        m_insertPosition.bindValue(3, move);
+        m_insertPosition.bindValue(4, result);
+        if (!exec(m_insertPosition))
+            return false;
+        // A position indexed before is already counted
+        if (m_insertPosition.numRowsAffected()<=0)
+            continue;
+        m_countMove.bindValue(0, qint64(keys[ply]));
+        m_countMove.bindValue(1, move.isNull() ? QString("") : move); // NULL cannot be part of the key
+        m_countMove.bindValue(2, int(result=="1-0"));
+        m_countMove.bindValue(3, int(result=="1/2-1/2"));
+        m_countMove.bindValue(4, int(result=="0-1"));
+        if (!exec(m_countMove))
+            return false;
+    }
+    return true;
+}
+
+QVector<GameSummary> GameDatabase::games(const QString &player, int limit)
+{
+    QVector<GameSummary> list;
+    m_selectGames.bindValue(0, player);
+    m_selectGames.bindValue(1, player);
+    m_selectGames.bindValue(2, player);
+    m_selectGames.bindValue(3, limit);
+    if (!exec(m_selectGames))
+        return list;
+    while (m_selectGames.next())
+        list.append(readSummary(m_selectGames));
+    m_selectGames.finish();
+    return list;
+}
+
+QVector<StoredMove> GameDatabase::moves(qint64 game)
+{
+    QVector<StoredMove> list;
+    m_selectMoves.bindValue(0, game);
+    if (!exec(m_selectMoves))
+        return list;
+    while (m_selectMoves.next())
+        list.append({m_selectMoves.value(0).toString(), m_selectMoves.value(1).toLongLong()});
+    m_selectMoves.finish();
+    return list;
+}
+
+PositionStats GameDatabase::position(quint64 key, int limit)
+{
+    TRACE_SCOPE("GameDatabase::position");
+    PositionStats stats;
+    stats.key = key;
+    m_positionMoves.bindValue(0, qint64(key));
+    if (!exec(m_positionMoves))
+        return stats;
+    while (m_positionMoves.next()) {
+        PositionMove m;
+        m.uci = m_positionMoves.value(0).toString();
+        m.count = m_positionMoves.value(1).toInt();
+        m.whiteWins = m_positionMoves.value(2).toInt();
+        m.draws = m_positionMoves.value(3).toInt();
+        m.blackWins = m_positionMoves.value(4).toInt();
+        stats.count += m.count;
+        stats.moves.append(m);
+    }
+    m_positionMoves.finish();
+
+    m_positionGames.bindValue(0, qint64(key));
+    m_positionGames.bindValue(1, limit);
+    if (!exec(m_positionGames))
+        return stats;
+    while (m_positionGames.next())
+        stats.games.append(readSummary(m_positionGames));
+    m_positionGames.finish();
+    return stats;
+}
@@ -0,0 +1,127 @@
+#ifndef GAMEDATABASE_H
+#define GAMEDATABASE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QVector>
+
+struct StoredMove
+{
+    QString uci;
+    qint64 clock = -1; // mover's remaining time in ms after the move, -1 if untimed
+};
+
+struct GameRecord
+{
+    QString white;
+    QString black;
+    QString result = "*";
+    QString termination;
+    QString timeControl;
+    QString startFen;      // empty for the initial position
+    qint64 started = 0;    // ms since the epoch
+    qint64 finished = 0;
+    QVector<StoredMove> moves;
+    // Position keys before each move and after the last, if the caller has
+    // them; otherwise they are worked out by replaying the moves
+    QVector<quint64> keys;
+};
+
+struct GameSummary
+{
+    qint64 id = 0;
+    QString white;
+    QString black;
+    QString result;
+    QString termination;
+    QString timeControl;
+    qint64 started = 0;
+    int plies = 0;
+};
+
+// How often a move was played from a position and how those games ended
+struct PositionMove
+{
+    QString uci; // empty for games that ended in the position
+    int count = 0;
+    int whiteWins = 0;
+    int draws = 0;
+    int blackWins = 0;
+};
+
+struct PositionStats
+{
+    quint64 key = 0;
+    int count = 0; // times the position was reached, over all games
+    QVector<PositionMove> moves; // most played first
+    QVector<GameSummary> games;  // newest games that reached it
+};
+
+// Games with their moves and clocks in SQLite. Statements are prepared once
+// per connection and reused; callers group writes with begin()/commit().
+// Every position of a finished game is indexed by its ChessBoard::key(),
+// so the games through a position are one index range away, and the moves
+// played from it are counted in a table of their own.
+// Not thread-safe: a connection belongs to the thread that opened it.
+class GameDatabase
+{
+public:
+    GameDatabase() = default;
+    ~GameDatabase() { close(); }
+    GameDatabase(const GameDatabase &) = delete;
+    GameDatabase &operator=(const GameDatabase &) = delete;
+
+    // Opens (and creates) the schema on a connection of its own in WAL mode
+    bool open(const QString &path, const QString &connectionName);
+    void close();
+    bool isOpen() const { return m_db.isOpen(); }
+    QString lastError() const { return m_error; }
+
+    bool begin();
+    bool commit();
+    void rollback();
+    // A savepoint inside the open transaction: rollbackWrite() undoes what
+    // was written since, without losing the rest of the transaction
+    bool beginWrite();
+    bool commitWrite();
+    void rollbackWrite();
+
+    // Inserts the game header and any moves it already has; 0 on failure.
+    // A game given with its moves is complete and its positions are indexed
+    // at once, one started without moves is indexed by finishGame.
+    qint64 addGame(const GameRecord &game);
+    bool addMove(qint64 game, int ply, const StoredMove &move);
+    bool finishGame(qint64 game, const QString &result, const QString &termination, qint64 finished);
+
+    // Newest first; an empty player lists everyone's games
+    QVector<GameSummary> games(const QString &player, int limit);
+    QVector<StoredMove> moves(qint64 game);
+    // Moves played from the position with the given key and up to limit of
+    // the games that reached it
+    PositionStats position(quint64 key, int limit);
+
+private:
+    bool exec(QSqlQuery &query);
+    bool indexGame(qint64 game, const QString &startFen, const QString &result,
+                   const QVector<StoredMove> &moves, QVector<quint64> keys);
+
+    QSqlDatabase m_db;
+    QString m_connection;
+    QString m_error;
+    QSqlQuery m_insertGame;
+    QSqlQuery m_insertMove;
+    QSqlQuery m_finishGame;
+    QSqlQuery m_selectGames;
+    QSqlQuery m_selectMoves;
+    QSqlQuery m_selectStart;
+    QSqlQuery m_insertPosition;
+    QSqlQuery m_countMove;
+    QSqlQuery m_positionMoves;
+    QSqlQuery m_positionGames;
+    QSqlQuery m_savepoint;
+    QSqlQuery m_release;
+    QSqlQuery m_rollbackTo;
+};
+
+#endif // GAMEDATABASE_H
@@ -0,0 +1,203 @@
+#include "gamestore.h"
+#include "trace.h"
+#include <QDateTime>
+#include <QMetaObject>
+#include <QTimer>
+#include <vector>
+
+namespace {
+
+// Writes held back before a commit is forced
+constexpr int BatchSize = 1000;
+// Longest a write waits for company before it is committed anyway
+constexpr int FlushDelayMs = 100;
+
+} // namespace
+
+class GameStore::Worker : public QObject
+{
+public:
+    Worker(GameStore *store, const QString &path)
+        : m_store(store), m_path(path)
+    {
+    }
+
+    // Runs on the DB thread once it has started
+    void open()
+    {
+        Trace::setThreadName("chessqt-db");
+        m_flush = new QTimer(this);
+        m_flush->setSingleShot(true);
+        connect(m_flush, &QTimer::timeout, this, [this] { flush(); });
+        if (!m_db.open(m_path, "chessqt-games"))
+            report(m_db.lastError());
+    }
+
+    void close()
+    {
+        flush();
+        m_db.close();
+    }
+
+    // Queues a write for the next transaction
+    void write(std::function<bool(GameDatabase &)> op)
+    {
+        m_pending.push_back(std::move(op));
+        if (int(m_pending.size())>=BatchSize)
+            flush();
+        else if (!m_flush->isActive())
+            m_flush->start(FlushDelayMs);
+    }
+
+    void flush()
+    {
+        m_flush->stop();
+        if (m_pending.empty() || !m_db.isOpen()) {
+            m_pending.clear();
+            return;
+        }
+        std::vector<std::function<bool(GameDatabase &)>> ops;
+        ops.swap(m_pending);
+        if (!m_db.begin()) {
+            report(m_db.lastError());
+            return;
+        }
+        // A write that fails is undone and reported on its own; the rest of
+        // the batch, often other games' moves, is still committed
+        for (auto &op : ops) {
+            if (!m_db.beginWrite()) {
+                report(m_db.lastError());
+                m_db.rollback();
+                return;
+            }
+            if (op(m_db) && m_db.commitWrite())
+                continue;
+            report(m_db.lastError());
+            m_db.rollbackWrite();
+        }
+        // A failed commit has already been rolled back
+        if (!m_db.commit())
+            report(m_db.lastError());
+    }
+
+    GameDatabase &db()
+    {
+        // Reads see every write queued before them
+        flush();
+        return m_db;
+    }
+
+    void report(const QString &message)
+    {
+        QMetaObject::invokeMethod(m_store, [store = m_store, message] {
+            emit store->error(message);
+        }, Qt::QueuedConnection);
+    }
+
+    QHash<int, qint64> ids; // handle -> games.id
+    QHash<int, int> plies;  // handle -> moves recorded so far
+
+private:
+    GameStore *m_store;
+    QString m_path;
+    GameDatabase m_db;
+    QTimer *m_flush = nullptr;
+    std::vector<std::function<bool(GameDatabase &)>> m_pending;
+};
+
+GameStore::GameStore(const QString &path, QObject *parent)
+    : QObject(parent)
+{
+    m_worker = new Worker(this, path);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName("chessqt-db");
+    m_thread.start();
+    post([](Worker &w) { w.open(); });
+}
+
+GameStore::~GameStore()
+{
+    // Pending writes are committed before the thread goes away
+    QMetaObject::invokeMethod(m_worker, [w = m_worker] { w->close(); }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void GameStore::post(std::function<void(Worker &)> task)
+{
+    QMetaObject::invokeMethod(m_worker, [w = m_worker, task = std::move(task)] { task(*w); },
+                              Qt::QueuedConnection);
+}
+
+int GameStore::beginGame(const GameRecord &header)
+{
+    const int handle = ++m_nextHandle;
+    post([handle, header](Worker &w) {
+        // The row is needed for its id, so it is written right away
+        const qint64 id = w.db().addGame(header);
+        if (id==0)
+            w.report(w.db().lastError());
+        w.ids.insert(handle, id);
+    });
+    return handle;
+}
+
+void GameStore::addMove(int game, const StoredMove &move)
+{
+    post([game, move](Worker &w) {
+        const qint64 id = w.ids.value(game);
+        if (id==0)
+            return;
+        const int ply = w.plies[game] += 1;
+        w.write([id, ply, move](GameDatabase &db) { return db.addMove(id, ply, move); });
+    });
+}
+
+void GameStore::finishGame(int game, const QString &result, const QString &termination)
+{
+    const qint64 finished = QDateTime::currentMSecsSinceEpoch();
+    post([game, result, termination, finished](Worker &w) {
+        const qint64 id = w.ids.take(game);
+        w.plies.remove(game);
+        if (id==0)
+            return;
+        w.write([id, result, termination, finished](GameDatabase &db) {
+            return db.finishGame(id, result, termination, finished);
+        });
+        // A finished game should survive the application closing right after
+        w.flush();
+    });
+}
+
+void GameStore::importGames(const QVector<GameRecord> &games)
+{
+    post([games](Worker &w) {
+        for (const GameRecord &g : games)
+            w.write([g](GameDatabase &db) { return db.addGame(g)!=0; });
+    });
+}
+
+void GameStore::requestGames(const QString &player, int limit)
+{
+    post([this, player, limit](Worker &w) {
+        const QVector<GameSummary> list = w.db().games(player, limit);
+        QMetaObject::invokeMethod(this, [this, list] { emit gamesLoaded(list); }, Qt::QueuedConnection);
+    });
+}
+
+void GameStore::requestMoves(qint64 id)
+{
+    post([this, id](Worker &w) {
+        const QVector<StoredMove> list = w.db().moves(id);
+        QMetaObject::invokeMethod(this, [this, id, list] { emit movesLoaded(id, list); }, Qt::QueuedConnection);
+    });
+}
+
+void GameStore::requestPosition(quint64 key, int limit)
+{
+    post([this, key, limit](Worker &w) {
+        const PositionStats stats = w.db().position(key, limit);
+        QMetaObject::invokeMethod(this, [this, stats] { emit positionLoaded(stats); }, Qt::QueuedConnection);
+    });
+}
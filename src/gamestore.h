@@ -0,0 +1,49 @@
+#ifndef GAMESTORE_H
+#define GAMESTORE_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <functional>
+#include "gamedatabase.h"
+
+// Game persistence off the GUI thread. Every call returns at once; the work
+// runs on a DB thread with its own connection, where writes are collected
+// and committed together, either once enough are pending or shortly after
+// the first one. Results of reads come back through signals on the owner's
+// thread.
+class GameStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GameStore(const QString &path, QObject *parent = nullptr);
+    ~GameStore() override;
+
+    // Starts recording a game; the handle stands for it in later calls
+    int beginGame(const GameRecord &header);
+    void addMove(int game, const StoredMove &move);
+    void finishGame(int game, const QString &result, const QString &termination);
+    void importGames(const QVector<GameRecord> &games);
+
+    void requestGames(const QString &player, int limit);
+    void requestMoves(qint64 id);
+    // Moves played from the position with this ChessBoard::key() in stored
+    // games, and the newest of those games
+    void requestPosition(quint64 key, int limit);
+
+signals:
+    void gamesLoaded(const QVector<GameSummary> &games);
+    void movesLoaded(qint64 id, const QVector<StoredMove> &moves);
+    void positionLoaded(const PositionStats &stats);
+    void error(const QString &message);
+
+private:
+    class Worker;
+    void post(std::function<void(Worker &)> task);
+
+    QThread m_thread;
+    Worker *m_worker = nullptr;
+    int m_nextHandle = 0;
+};
+
+#endif // GAMESTORE_H
@@ -4,6 +4,20 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QMessageBox>
+#include "trace.h"
+
+namespace {
+
+constinit const Trace::Point UsersQuery("Login query");
+
+// Runs a users-table query, timed without the dialogs that follow it
+bool execQuery(QSqlQuery &query)
+{
+    const Trace::Scope scope(UsersQuery);
+    return query.exec();
+}
+
+} // namespace
 
 Login::Login(QWidget *parent)
     : QDialog(parent)
@@ -33,10 +47,16 @@ void Login::setupDb()
 {
     QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
     db.setDatabaseName("players.db");
-    if (!db.open())
+    bool opened;
+    {
+        TRACE_SCOPE("Login open database");
+        opened = db.open();
+    }
+    if (!opened)
         QMessageBox::critical(this, "DB", "Failed to open database");
     QSqlQuery query(db);
-    query.exec("CREATE TABLE IF NOT EXISTS users(name TEXT PRIMARY KEY, pass TEXT)");
+    query.prepare("CREATE TABLE IF NOT EXISTS users(name TEXT PRIMARY KEY, pass TEXT)");
+    execQuery(query);
 }
 
 void Login::signIn()
@@ -45,7 +65,7 @@ void Login::signIn()
     query.prepare("INSERT INTO users(name, pass) VALUES(?, ?)");
     query.addBindValue(m_userEdit->text());
     query.addBindValue(m_passEdit->text());
-    if (!query.exec()) {
+    if (!execQuery(query)) {
         QMessageBox::warning(this, "Sign in", "User exists");
         return;
     }
@@ -57,7 +77,7 @@ void Login::logIn()
     QSqlQuery query;
     query.prepare("SELECT pass FROM users WHERE name=?");
     query.addBindValue(m_userEdit->text());
-    if (!query.exec() || !query.next() || query.value(0).toString() != m_passEdit->text()) {
+    if (!execQuery(query) || !query.next() || query.value(0).toString() != m_passEdit->text()) {
         QMessageBox::warning(this, "Login", "Invalid credentials");
         return;
     }
@@ -1,9 +1,12 @@
 #include <QApplication>
 #include "login.h"
+#include "trace.h"
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    const Trace::Session traceSession;
+    Trace::setThreadName("main");
 
     bool again;
     do {
@@ -9,11 +9,45 @@
 #include <QLabel>
 #include <QRandomGenerator>
 #include <algorithm>
+#include <cstdlib>
 #include <ranges>
-#include <QProcess>
 #include <QFile>
 #include <QCoreApplication>
+#include <QFileDialog>
+#include <QSettings>
+#include <QDateTime>
+#include <QDialog>
+#include <QListWidget>
 #include "boardview.h"
+#include "nnue.h"
+#include "spritecache.h"
+#include "trace.h"
+
+namespace {
+
+// Stockfish reports tablebase wins as scores just below 20000 centipawns
+constexpr int TablebaseWinCp = 19000;
+
+// From asking for a move to applying it, book moves included
+constinit const Trace::Point EngineRoundTrip("engine round-trip");
+
+// Tablebase result for the side to move, told from White's point of view
+QString tablebaseText(Syzygy::Wdl wdl, ChessBoard::Color toMove)
+{
+    if(wdl==Syzygy::Draw)
+        return "Draw (tablebase)";
+    if(wdl==Syzygy::CursedWin || wdl==Syzygy::BlessedLoss)
+        return "Draw by fifty-move rule (tablebase)";
+    return (wdl>0)==(toMove==ChessBoard::White) ? "White wins (tablebase)" : "Black wins (tablebase)";
+}
+
+// Square of the coordinate at 'at' in a UCI move such as "e2e4"
+int uciSquare(std::string_view uci, int at)
+{
+    return uci.size()<std::size_t(at+2) ? -1 : ChessBoard::parseSquare(uci.substr(at, 2));
+}
+
+} // namespace
 
 MainWindow::MainWindow(const QString &user, QWidget *parent)
     : QMainWindow(parent), m_player(user)
@@ -22,6 +56,11 @@ MainWindow::MainWindow(const QString &user, QWidget *parent)
     m_scene = new QGraphicsScene(this);
     m_view = new BoardView(m_scene, &m_board, this);
     m_scene->setSceneRect(0,0,400,400);
+    // Pieces move every frame while animating; keeping a BSP index of 100
+    // items up to date costs more than a linear scan of them
+    m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
+    m_animator = new PieceAnimator(this);
+    buildBoardItems();
 
     m_whiteLabel = new QLabel(this);
     m_blackLabel = new QLabel(this);
@@ -30,12 +69,102 @@ MainWindow::MainWindow(const QString &user, QWidget *parent)
     m_resignBtn = new QPushButton("Resign", this);
     m_resignBtn->setVisible(false);
     connect(m_resignBtn, &QPushButton::clicked, this, &MainWindow::resignGame);
+    m_positionBtn = new QPushButton("Games from here", this);
+    m_positionBtn->setVisible(false);
+    connect(m_positionBtn, &QPushButton::clicked, this, &MainWindow::showPositionGames);
+    m_evalBar = new EvalBar(this);
+    m_evalBar->setVisible(false);
+    m_pvLabel = new QLabel(this);
+    m_pvLabel->setWordWrap(true);
+    m_pvLabel->setVisible(false);
+    connect(&m_clock, &GameClock::flagFell, this, [this](ChessBoard::Color c){
+        updateTimerDisplay();
+        QMessageBox::information(this, "Time", c==ChessBoard::White?"Black wins":"White wins");
+        endGame(c==ChessBoard::White?"0-1":"1-0", "time forfeit");
+    });
+
+    // Games go to the players database from a thread of their own
+    m_store = new GameStore("players.db", this);
+    connect(m_store, &GameStore::error, this, [this](const QString &message){
+        QMessageBox::warning(this, "Game history", message);
+    });
+
+    // Optional opening book next to the executable, used with either engine
+    m_book.open(QCoreApplication::applicationDirPath()+"/book.bin");
+
+    m_engine = new NativeEngine(this);
+    connect(m_engine, &NativeEngine::bestMove, this, &MainWindow::applyAiMove);
+    connect(m_engine, &NativeEngine::info, this, &MainWindow::onEngineInfo);
+
+    // Stockfish starts in the background so it is ready by the first game
+    m_uci = new UciEngine(this);
+    m_uci->setProgram(stockfishPath());
+    m_uci->setOption("Ponder", "true");
+    // Syzygy tables are read from local directories only, by default a
+    // "syzygy" folder next to the executable
+    applyTablebasePath(QSettings("chessqt", "chessqt").value("syzygyPath",
+                       QCoreApplication::applicationDirPath()+"/syzygy").toString());
+    connect(m_uci, &UciEngine::bestMove, this, [this](const QString &move, const QString &ponder) {
+        applyAiMove(move);
+        startPondering(ponder);
+    });
+    connect(m_uci, &UciEngine::info, this, &MainWindow::onEngineInfo);
+    connect(m_uci, &UciEngine::failed, this, [this](const QString &reason) {
+        if(m_mode==VsAi && m_backend==Stockfish)
+            QMessageBox::warning(this, "AI", reason);
+    });
+    m_uci->start();
 
     showMenu();
 }
 
+bool MainWindow::chooseTimeControl()
+{
+    struct Preset { const char *name; int minutes; int increment; int delay; };
+    static const Preset presets[] = {
+        {"10 min", 10, 0, 0},
+        {"15 min + 10 s", 15, 10, 0},
+        {"5 min + 3 s", 5, 3, 0},
+        {"3 min + 2 s", 3, 2, 0},
+        {"5 min, 5 s delay", 5, 0, 5},
+        {"1 min", 1, 0, 0},
+    };
+    QStringList names;
+    for(const Preset &p : presets)
+        names << p.name;
+    bool ok=false;
+    QString choice = QInputDialog::getItem(this,"Time control","Select time control",names,0,false,&ok);
+    if(!ok) return false;
+    const Preset &p = presets[std::max<qsizetype>(0, names.indexOf(choice))];
+    m_timeControl.base = qint64(p.minutes)*60000;
+    m_timeControl.increment = qint64(p.increment)*1000;
+    m_timeControl.delay = qint64(p.delay)*1000;
+    return true;
+}
+
+void MainWindow::applyTablebasePath(const QString &path)
+{
+    m_tablebases.setPath(path);
+    // Positions in the tables are answered here; the engine still gets them
+    // to probe the endings its search runs into
+    m_uci->setOption("SyzygyPath", m_tablebases.isEmpty() ? QByteArray("<empty>") : path.toUtf8());
+}
+
+void MainWindow::chooseTablebases()
+{
+    const QString dir = QFileDialog::getExistingDirectory(this, "Syzygy tablebase directory", m_tablebases.path());
+    if(dir.isEmpty()) return;
+    applyTablebasePath(dir);
+    QSettings("chessqt", "chessqt").setValue("syzygyPath", dir);
+    if(m_tablebases.isEmpty())
+        QMessageBox::warning(this, "Tablebases", "No Syzygy tables (.rtbw) found in " + dir);
+    else
+        QMessageBox::information(this, "Tablebases", QString("%1 tables, up to %2 pieces").arg(m_tablebases.tableCount()).arg(m_tablebases.maxPieces()));
+}
+
 void MainWindow::chooseOffline()
 {
+    if(!chooseTimeControl()) return;
     m_mode = Offline;
     startGame();
 }
@@ -50,6 +179,15 @@ void MainWindow::chooseVsAi()
         m_playerColor = (QRandomGenerator::global()->bounded(2)==0)?ChessBoard::White:ChessBoard::Black;
     else
         m_playerColor = (choice=="White")?ChessBoard::White:ChessBoard::Black;
+    QStringList engines{"Stockfish","Built-in","Built-in (NNUE)"};
+    QString engine = QInputDialog::getItem(this,"Play vs AI","Select engine",engines,0,false,&ok);
+    if(!ok) return;
+    m_backend = engine.startsWith("Built-in")?BuiltIn:Stockfish;
+    // The NNUE choice plays the embedded network, the other one the
+    // hand-written evaluation or a local chessqt.nnue
+    if(m_backend==BuiltIn)
+        m_engine->setEvalFile(engine=="Built-in (NNUE)" ? QString(Nnue::DefaultNetwork) : NativeEngine::localNetwork());
+    if(!chooseTimeControl()) return;
     m_mode = VsAi;
     startGame();
     if(m_playerColor==ChessBoard::Black)
@@ -58,25 +196,31 @@ void MainWindow::chooseVsAi()
 
 void MainWindow::startGame()
 {
-    m_whiteTime = 600;
-    m_blackTime = 600;
+    m_clock.reset(m_timeControl);
     m_board.reset();
-    m_highlight.clear();
-
-    m_scene->clear();
+    m_tablebaseResult.clear();
+    m_animator->finishAll();
+    m_overlay->clear();
 
     if(QWidget *old = centralWidget())
         old->deleteLater();
     auto *central = new QWidget(this);
     auto *layout = new QVBoxLayout(central);
     layout->setContentsMargins(0,0,0,0);
-    layout->addWidget(m_view);
+    auto *boardLayout = new QHBoxLayout();
+    boardLayout->addWidget(m_evalBar);
+    boardLayout->addWidget(m_view);
+    layout->addLayout(boardLayout);
     auto *timerLayout = new QHBoxLayout();
     timerLayout->addWidget(m_whiteLabel);
     timerLayout->addStretch();
     timerLayout->addWidget(m_blackLabel);
     layout->addLayout(timerLayout);
-    layout->addWidget(m_resignBtn);
+    layout->addWidget(m_pvLabel);
+    auto *buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(m_positionBtn);
+    buttonLayout->addWidget(m_resignBtn);
+    layout->addLayout(buttonLayout);
     setCentralWidget(central);
     m_view->show();
     m_view->setVsAiMode(m_mode==VsAi);
@@ -86,73 +230,199 @@ void MainWindow::startGame()
     m_whiteLabel->setVisible(true);
     m_blackLabel->setVisible(true);
     m_resignBtn->setVisible(true);
+    m_positionBtn->setVisible(true);
+    m_evalBar->clear();
+    m_evalBar->setVisible(m_mode==VsAi);
+    m_pvLabel->clear();
+    m_pvLabel->setVisible(m_mode==VsAi);
+    m_lastInfo = UciInfo();
+    m_infoPending = false;
     updateTimerDisplay();
 
-    m_timer.start(1000);
+    // The clock keeps its own time; this only refreshes the labels
+    m_clock.start(m_board.currentColor());
+    m_timer.start(100);
     connect(&m_timer, &QTimer::timeout, this, &MainWindow::updateTimer);
     connect(m_view, &BoardView::boardChanged, this, &MainWindow::onBoardChange);
     connect(m_view, &BoardView::highlightChanged, this, &MainWindow::setHighlight);
 
 
-    if(m_mode==VsAi)
-        startAiEngine();
+    if(m_mode==VsAi && m_backend==Stockfish && m_uci->state()==UciEngine::Failed){
+        // Startup failed earlier; report it and try again in the background
+        QMessageBox::warning(this, "AI", "Failed to start Stockfish at " + m_uci->program());
+        m_uci->start();
+    }
+    m_ponderMove.clear();
+    GameRecord header;
+    const QString ai = m_backend==Stockfish ? "Stockfish" : "Built-in";
+    const QString opponent = m_mode==VsAi ? ai : "Guest";
+    header.white = m_mode==VsAi && m_playerColor==ChessBoard::Black ? opponent : m_player;
+    header.black = header.white==m_player ? opponent : m_player;
+    header.timeControl = QString("%1+%2").arg(m_timeControl.base/1000).arg((m_timeControl.increment+m_timeControl.delay)/1000);
+    header.started = QDateTime::currentMSecsSinceEpoch();
+    m_storedGame = m_store->beginGame(header);
+
+    m_inBook = m_book.isOpen();
+    m_book.resetStats();
+    if(m_mode==VsAi && m_backend==Stockfish)
+        m_uci->newGame();
+    if(m_mode==VsAi && m_backend==BuiltIn)
+        m_engine->newGame();
 
 }
 
 void MainWindow::updateTimer()
 {
-    if (m_board.currentColor()==ChessBoard::White)
-        --m_whiteTime;
-    else
-        --m_blackTime;
     updateTimerDisplay();
-    if (m_whiteTime<=0 || m_blackTime<=0) {
-        QMessageBox::information(this, "Time", m_whiteTime<=0?"Black wins":"White wins");
-        endGame();
+    showEngineInfo();
+}
+
+void MainWindow::onEngineInfo(const UciInfo &info)
+{
+    if(m_mode!=VsAi || info.multiPv!=1)
         return;
+    // Partial reports (e.g. a bare pv) keep the last score and depth
+    if(info.hasScore)
+        m_lastInfo = info;
+    else
+        m_lastInfo.pv = info.pv;
+    m_infoPending = true;
+}
+
+void MainWindow::showEngineInfo()
+{
+    if(!m_infoPending)
+        return;
+    m_infoPending = false;
+    const UciInfo &info = m_lastInfo;
+    // Engines score for the side to move, which is always the AI here
+    // (pondering searches the position after the expected reply)
+    const int sign = m_playerColor==ChessBoard::White ? -1 : 1;
+    QString score;
+    if(info.hasScore){
+        if(info.isMate){
+            m_evalBar->setMate(sign*info.score);
+            score = QString("M%1").arg(sign*info.score);
+        }else{
+            m_evalBar->setScore(sign*info.score);
+            score = QString::asprintf("%+.2f", sign*info.score/100.0);
+        }
+        // A fail-high/low score is only a bound, seen from White here
+        if(info.bound!=UciInfo::Exact)
+            score.prepend((info.bound==UciInfo::LowerBound)==(sign>0) ? ">=" : "<=");
+        // Results the tablebases know are shown as such
+        if(!m_tablebaseResult.isEmpty())
+            score = m_tablebaseResult;
+        else if(!info.isMate && std::abs(info.score)>=TablebaseWinCp)
+            score = sign*info.score>0 ? "White wins (tablebase)" : "Black wins (tablebase)";
+    }
+    QString text = QString("Depth %1").arg(info.depth);
+    if(!score.isEmpty())
+        text += "  " + score;
+    if(info.nps>0)
+        text += QString::asprintf("  %.1f Mn/s", info.nps/1e6);
+    text += "\n" + info.pv.mid(0, 16).join(' ');
+    m_pvLabel->setText(text);
+
+    // Point at the move being considered, unless the engine is pondering a
+    // position that is not on the board yet
+    const bool aiToMove = m_board.currentColor()!=m_playerColor;
+    if(aiToMove && !m_uci->isPondering() && !info.pv.isEmpty()){
+        const std::string best = info.pv.first().toStdString();
+        if(!m_board.parseUci(best).isNull())
+            m_overlay->setArrow(uciSquare(best, 0), uciSquare(best, 2));
     }
 }
 
-void MainWindow::redrawBoard()
+void MainWindow::buildBoardItems()
 {
-    m_scene->clear();
+    const qreal dpr = devicePixelRatioF();
+    for(int p = ChessBoard::WP; p <= ChessBoard::BK; ++p)
+        m_piecePixmaps[p] = SpriteCache::piece(ChessBoard::Piece(p), 50, dpr);
+
     // Functional style: generate numbers 0..7 with a view and iterate using ranges
     auto rng = std::views::iota(0,8);
     std::ranges::for_each(rng, [&](int r){
         std::ranges::for_each(rng, [&](int c){
+            const int sq = r*8+c;
             QBrush brush = ((r+c)%2)?QBrush(Qt::gray):QBrush(Qt::white);
-            if(std::any_of(m_highlight.cbegin(), m_highlight.cend(), [&](const QPoint &p){ return p.x()==r && p.y()==c; }))
-                brush = QBrush(Qt::yellow);
-            m_scene->addRect(c*50,r*50,50,50,QPen(),brush);
-            ChessBoard::Piece p = m_board.pieceAt(r,c);
-            if (p!=ChessBoard::Empty) {
-                QString name;
-                switch (p) {
-                case ChessBoard::WP: name="pawn_w"; break;
-                case ChessBoard::WR: name="rook_w"; break;
-                case ChessBoard::WN: name="knight_w"; break;
-                case ChessBoard::WB: name="bishop_w"; break;
-                case ChessBoard::WQ: name="queen_w"; break;
-                case ChessBoard::WK: name="king_w"; break;
-                case ChessBoard::BP: name="pawn_b"; break;
-                case ChessBoard::BR: name="rook_b"; break;
-                case ChessBoard::BN: name="knight_b"; break;
-                case ChessBoard::BB: name="bishop_b"; break;
-                case ChessBoard::BQ: name="queen_b"; break;
-                case ChessBoard::BK: name="king_b"; break;
-                default: break;
-                }
-                QPixmap pix(":/images/"+name+".png");
-                if(pix.isNull())
-                    pix.load("../assets/"+name+".png");
-                m_scene->addPixmap(pix.scaled(50,50))->setPos(c*50,r*50);
-            }
+            m_squareItems[sq] = m_scene->addRect(c*50,r*50,50,50,QPen(),brush);
+            m_pieceItems[sq] = m_scene->addPixmap(QPixmap());
+            m_pieceItems[sq]->setPos(c*50,r*50);
+            m_pieceItems[sq]->setZValue(1);
+            m_shownPieces[sq] = ChessBoard::Empty;
         });
     });
+    m_overlay = new BoardOverlay(m_scene, 50);
+}
+
+void MainWindow::redrawBoard()
+{
+    TRACE_SCOPE("MainWindow::redrawBoard");
+    // A move made mid-slide lands the previous one first
+    m_animator->finishAll();
+
+    // Comparing against what is shown catches every square a move touched,
+    // castling rooks and en-passant victims included
+    std::array<ChessBoard::Piece, 64> before = m_shownPieces;
+    QVector<int> arrived, left;
+    for(int sq=0; sq<64; ++sq){
+        const ChessBoard::Piece p = m_board.pieceAt(sq);
+        if(p==m_shownPieces[sq])
+            continue;
+        if(m_shownPieces[sq]!=ChessBoard::Empty)
+            left.append(sq);
+        if(p!=ChessBoard::Empty)
+            arrived.append(sq);
+        m_shownPieces[sq] = p;
+        m_pieceItems[sq]->setPixmap(m_piecePixmaps[p]);
+    }
+
+    // A single move brings at most a king and a rook somewhere new; bigger
+    // changes (new game, loaded position) just appear. Each arriving piece
+    // slides in from the square the same piece left.
+    if(arrived.size()<=2){
+        for(int to : arrived){
+            for(int from : left){
+                if(before[from]!=m_board.pieceAt(to) || from==to)
+                    continue;
+                before[from] = ChessBoard::Empty;
+                m_animator->slide(m_pieceItems[to], QPointF((from%8)*50, (from/8)*50), QPointF((to%8)*50, (to/8)*50));
+                break;
+            }
+        }
+    }
+    updateOverlay();
+}
+
+void MainWindow::updateOverlay()
+{
+    const std::vector<std::string> &moves = m_board.history();
+    if(moves.empty())
+        m_overlay->setLastMove(-1, -1);
+    else
+        m_overlay->setLastMove(uciSquare(moves.back(), 0), uciSquare(moves.back(), 2));
+    const ChessBoard::CheckInfo check = m_board.checkInfo(m_board.currentColor());
+    m_overlay->setCheck(check.checkers ? check.king : -1);
+    // An arrow belongs to the position it was computed for
+    m_overlay->setArrow(-1, -1);
 }
 
 void MainWindow::onBoardChange()
 {
+    // Charge the move exactly when it is made, not on the next display tick
+    m_clock.switchTo(m_board.currentColor());
+    m_tablebaseResult.clear();
+    if(m_tablebases.covers(m_board)){
+        ChessBoard probe = m_board;
+        Syzygy::Wdl wdl;
+        if(m_tablebases.probeWdl(probe, wdl))
+            m_tablebaseResult = tablebaseText(wdl, m_board.currentColor());
+    }
+    if(m_storedGame && !m_board.history().empty()){
+        const ChessBoard::Color mover = m_board.currentColor()==ChessBoard::White ? ChessBoard::Black : ChessBoard::White;
+        m_store->addMove(m_storedGame, {QString::fromStdString(m_board.history().back()), m_clock.remaining(mover)});
+    }
     redrawBoard();
     checkGameOver();
     if(m_mode==VsAi && m_board.currentColor()!=m_playerColor)
@@ -161,46 +431,113 @@ void MainWindow::onBoardChange()
 
 void MainWindow::setHighlight(const QVector<QPoint> &moves)
 {
-    m_highlight = moves;
-    redrawBoard();
+    std::bitset<64> squares;
+    for(const QPoint &p : moves)
+        squares.set(p.x()*8+p.y());
+    m_overlay->setHighlights(squares);
 }
 
 void MainWindow::requestAiMove()
 {
-    // Ensure the Stockfish engine is running before sending commands
-    startAiEngine();
-    if(!m_ai || m_ai->state()!=QProcess::Running)
+    m_aiRequested = Trace::start();
+
+    // Known openings are answered from the book without asking an engine.
+    // Once the game leaves the book it does not come back.
+    if(m_inBook){
+        const Move m = m_book.pick(m_board);
+        if(!m.isNull()){
+            m_ponderMove.clear();
+            m_uci->stop();
+            m_infoPending = false;
+            m_pvLabel->setText(QString("Book move (%1 of %2 positions in book)").arg(m_book.hits()).arg(m_book.probes()));
+            // Applied from the event loop: this runs inside the player's move
+            const QString uci = QString::fromStdString(ChessBoard::toUci(m));
+            QTimer::singleShot(0, this, [this, uci]{ applyAiMove(uci); });
+            return;
+        }
+        m_inBook = false;
+    }
+
+    // Positions the tables decide are played from them with either backend
+    if(m_tablebases.covers(m_board)){
+        ChessBoard probe = m_board;
+        Syzygy::Prober::RootMove best;
+        if(m_tablebases.probeRoot(probe, best)){
+            m_ponderMove.clear();
+            m_uci->stop();
+            m_infoPending = false;
+            QString text = tablebaseText(best.wdl, m_board.currentColor());
+            if(best.dtz!=0)
+                text += QString(", %1 plies to zeroing").arg(std::abs(best.dtz));
+            m_pvLabel->setText(text);
+            const QString uci = QString::fromStdString(ChessBoard::toUci(best.move));
+            QTimer::singleShot(0, this, [this, uci]{ applyAiMove(uci); });
+            return;
+        }
+    }
+
+    if(m_backend==BuiltIn){
+        // Budget the move from the game clock rather than a fixed depth
+        SearchLimits limits;
+        const qint64 inc = m_timeControl.increment + m_timeControl.delay;
+        for(ChessBoard::Color c : {ChessBoard::White, ChessBoard::Black}){
+            limits.time[c] = m_clock.remaining(c);
+            limits.increment[c] = inc;
+        }
+        m_engine->go(m_board, limits);
         return;
+    }
 
-    // Ask Stockfish for the best move from the current board position
-    QByteArray cmd = "position fen " + m_board.toFen().toUtf8() + "\n";
-    cmd += "go depth 12\n";
-    m_ai->write(cmd);
+    // The engine has been searching this exact position on the player's time
+    const std::vector<std::string> &moves = m_board.history();
+    if(!m_ponderMove.isEmpty() && m_uci->isPondering() && !moves.empty() && moves.back()==m_ponderMove.toStdString()){
+        m_ponderMove.clear();
+        m_uci->ponderHit();
+        return;
+    }
+    m_ponderMove.clear();
+    m_uci->stop();
+    m_infoPending = false;
 
-    // When the engine responds, handle the move exactly once
-    connect(m_ai, &QProcess::readyReadStandardOutput, this,
-            &MainWindow::handleAiOutput, Qt::UniqueConnection);
+    // Commands are queued by UciEngine until the engine has finished its handshake
+    m_uci->go(QByteArray::fromStdString(m_board.uciPosition()), uciGoCommand());
 }
 
-void MainWindow::handleAiOutput()
+QByteArray MainWindow::uciGoCommand() const
 {
-    QByteArray data = m_ai->readAllStandardOutput();
-    m_aiBuffer += data;
-    int idx = m_aiBuffer.indexOf("bestmove");
-    if(idx == -1)
+    // UCI has no delay; the engine gets it as increment since it is time
+    // that does not come off the clock as long as it thinks that long
+    const qint64 inc = m_timeControl.increment + m_timeControl.delay;
+    return "go wtime " + QByteArray::number(m_clock.remaining(ChessBoard::White))
+         + " btime " + QByteArray::number(m_clock.remaining(ChessBoard::Black))
+         + " winc " + QByteArray::number(inc) + " binc " + QByteArray::number(inc);
+}
+
+// Lets the engine search the reply it expects while the player thinks
+void MainWindow::startPondering(const QString &ponder)
+{
+    if(m_mode!=VsAi || m_backend!=Stockfish || ponder.isEmpty() || m_board.currentColor()!=m_playerColor)
         return;
-    QByteArray line = m_aiBuffer.mid(idx).split('\n').first();
-    QString best = QString::fromUtf8(line).split(' ').value(1);
-    m_aiBuffer.clear();
-    if(best.size() >= 4){
-        QString from = best.mid(0,2);
-        QString to = best.mid(2,2);
-        if(m_board.move(from,to)){
-            m_view->clearSelection();
-            m_view->notifyBoardChanged();
-        }
+    if(m_board.parseUci(ponder.toStdString()).isNull())
+        return;
+    m_ponderMove = ponder;
+    QString position = QString::fromStdString(m_board.uciPosition());
+    position += m_board.history().empty() ? " moves " : " ";
+    position += ponder;
+    m_uci->goPonder(position.toUtf8(), uciGoCommand());
+}
+
+void MainWindow::applyAiMove(const QString &uci)
+{
+    if(m_mode!=VsAi || m_board.currentColor()==m_playerColor)
+        return;
+    Trace::complete(EngineRoundTrip, m_aiRequested);
+    m_aiRequested = 0;
+    Move m = m_board.parseUci(uci.toStdString());
+    if(!m.isNull() && m_board.move(m)){
+        m_view->clearSelection();
+        m_view->notifyBoardChanged();
     }
-    disconnect(m_ai, &QProcess::readyReadStandardOutput, this, &MainWindow::handleAiOutput);
 }
 
 void MainWindow::checkGameOver()
@@ -213,7 +550,19 @@ void MainWindow::checkGameOver()
         else
             msg = "Stalemate";
         QMessageBox::information(this,"Game Over",msg);
-        endGame();
+        if(m_board.isInCheck(cur))
+            endGame(cur==ChessBoard::White?"0-1":"1-0", "checkmate");
+        else
+            endGame("1/2-1/2", "stalemate");
+    }else if(m_board.isThreefoldRepetition()){
+        QMessageBox::information(this,"Game Over","Draw by threefold repetition");
+        endGame("1/2-1/2", "threefold repetition");
+    }else if(m_board.isInsufficientMaterial()){
+        QMessageBox::information(this,"Game Over","Draw by insufficient material");
+        endGame("1/2-1/2", "insufficient material");
+    }else if(m_board.halfmoveClock()>=100){
+        QMessageBox::information(this,"Game Over","Draw by fifty-move rule");
+        endGame("1/2-1/2", "fifty-move rule");
     }
 }
 
@@ -228,57 +577,66 @@ void MainWindow::showMenu()
     m_whiteLabel->setParent(this);
     m_blackLabel->setParent(this);
     m_resignBtn->setParent(this);
+    m_positionBtn->setParent(this);
+    m_evalBar->setParent(this);
+    m_pvLabel->setParent(this);
     m_view->hide();
     m_whiteLabel->setVisible(false);
     m_blackLabel->setVisible(false);
     m_resignBtn->setVisible(false);
+    m_positionBtn->setVisible(false);
+    m_evalBar->setVisible(false);
+    m_pvLabel->setVisible(false);
     auto *central = new QWidget(this);
     auto *layout = new QVBoxLayout(central);
     auto *playOffline = new QPushButton("Offline 2 Players", this);
     auto *playAi = new QPushButton("Play vs AI", this);
+    auto *tablebases = new QPushButton("Tablebases...", this);
+    auto *history = new QPushButton("Game history", this);
     layout->addWidget(playOffline);
     layout->addWidget(playAi);
+    layout->addWidget(history);
+    layout->addWidget(tablebases);
     setCentralWidget(central);
 
     connect(playOffline, &QPushButton::clicked, this, &MainWindow::chooseOffline);
     connect(playAi, &QPushButton::clicked, this, &MainWindow::chooseVsAi);
+    connect(tablebases, &QPushButton::clicked, this, &MainWindow::chooseTablebases);
+    connect(history, &QPushButton::clicked, this, &MainWindow::showHistory);
 }
 
-void MainWindow::endGame()
+void MainWindow::endGame(const QString &result, const QString &termination)
 {
+    if(m_storedGame){
+        m_store->finishGame(m_storedGame, result, termination);
+        m_storedGame = 0;
+    }
+    m_engine->stop();
+    m_uci->stop();
+    m_ponderMove.clear();
+    m_clock.stop();
     m_timer.stop();
     disconnect(&m_timer, &QTimer::timeout, this, &MainWindow::updateTimer);
     disconnect(m_view, &BoardView::boardChanged, this, &MainWindow::onBoardChange);
     disconnect(m_view, &BoardView::highlightChanged, this, &MainWindow::setHighlight);
-    m_highlight.clear();
+    m_overlay->setHighlights({});
     m_mode = Off;
     m_whiteLabel->setVisible(false);
     m_blackLabel->setVisible(false);
     m_resignBtn->setVisible(false);
+    m_positionBtn->setVisible(false);
+    m_infoPending = false;
     showMenu();
 }
 
 void MainWindow::updateTimerDisplay()
 {
-    // Lambda expression to format time as mm:ss
-    auto format=[&](int t){
-        return QString("%1:%2").arg(t/60,2,10,QChar('0')).arg(t%60,2,10,QChar('0'));
-    };
-    m_whiteLabel->setText("White: " + format(m_whiteTime));
-    m_blackLabel->setText("Black: " + format(m_blackTime));
+    m_whiteLabel->setText("White: " + GameClock::format(m_clock.remaining(ChessBoard::White)));
+    m_blackLabel->setText("Black: " + GameClock::format(m_clock.remaining(ChessBoard::Black)));
 }
 
-void MainWindow::startAiEngine()
+QString MainWindow::stockfishPath() const
 {
-    if(m_ai && m_ai->state()==QProcess::Running)
-        return;
-
-    if(m_ai){
-        delete m_ai;
-        m_ai = nullptr;
-    }
-
-    m_ai = new QProcess(this);
 #ifdef Q_OS_WIN
     const QString exe = "stockfish.exe";
 #else
@@ -294,29 +652,11 @@ void MainWindow::startAiEngine()
 
         exe
     };
-    QString prog;
     for(const QString &p : searchPaths){
-        if(QFile::exists(p)){
-            prog = p;
-            break;
-        }
-    }
-    if(prog.isEmpty())
-        prog = exe;
-    m_ai->setProgram(prog);
-    m_ai->start();
-    m_aiBuffer.clear();
-
-    if(m_ai->waitForStarted(1000)){
-        m_ai->write("uci\n");
-        m_ai->write("isready\n");
-        m_ai->waitForReadyRead(1000);
-        m_ai->readAll();
-    }else{
-        QMessageBox::warning(this, "AI", "Failed to start Stockfish at " + prog);
-        delete m_ai;
-        m_ai = nullptr;
+        if(QFile::exists(p))
+            return p;
     }
+    return exe;
 }
 
 void MainWindow::resignGame()
@@ -324,5 +664,86 @@ void MainWindow::resignGame()
     ChessBoard::Color cur = m_board.currentColor();
     QString msg = (cur==ChessBoard::White)?"White resigns. Black wins." : "Black resigns. White wins.";
     QMessageBox::information(this, "Game Over", msg);
-    endGame();
+    endGame(cur==ChessBoard::White?"0-1":"1-0", "resignation");
+}
+
+void MainWindow::showHistory()
+{
+    // Filled in when the DB thread answers; the window stays responsive
+    auto *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Game history - " + m_player);
+    auto *layout = new QVBoxLayout(dialog);
+    auto *list = new QListWidget(dialog);
+    auto *moves = new QLabel(dialog);
+    moves->setWordWrap(true);
+    layout->addWidget(list);
+    layout->addWidget(moves);
+    list->addItem("Loading...");
+    dialog->resize(480, 360);
+    dialog->show();
+
+    connect(m_store, &GameStore::gamesLoaded, dialog, [list](const QVector<GameSummary> &games){
+        list->clear();
+        for(const GameSummary &g : games){
+            auto *item = new QListWidgetItem(QString("%1  %2 - %3  %4  (%5 plies%6)")
+                .arg(QDateTime::fromMSecsSinceEpoch(g.started).toString("yyyy-MM-dd hh:mm"),
+                     g.white, g.black, g.result).arg(g.plies)
+                .arg(g.termination.isEmpty() ? QString() : ", " + g.termination), list);
+            item->setData(Qt::UserRole, g.id);
+        }
+        if(games.isEmpty())
+            list->addItem("No games yet");
+    });
+    connect(list, &QListWidget::currentItemChanged, dialog, [this](QListWidgetItem *item){
+        if(item && item->data(Qt::UserRole).isValid())
+            m_store->requestMoves(item->data(Qt::UserRole).toLongLong());
+    });
+    connect(m_store, &GameStore::movesLoaded, dialog, [list, moves](qint64 id, const QVector<StoredMove> &stored){
+        if(!list->currentItem() || list->currentItem()->data(Qt::UserRole).toLongLong()!=id)
+            return;
+        QStringList text;
+        for(int i=0; i<stored.size(); ++i)
+            text << (i%2==0 ? QString("%1. ").arg(i/2+1) : QString()) + stored[i].uci;
+        moves->setText(text.join(' '));
+    });
+    m_store->requestGames(m_player, 100);
+}
+
+void MainWindow::showPositionGames()
+{
+    // Looked up by the board's key on the DB thread, like the history
+    const quint64 key = m_board.key();
+    auto *dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle("Games from this position");
+    auto *layout = new QVBoxLayout(dialog);
+    auto *summary = new QLabel("Loading...", dialog);
+    auto *moves = new QListWidget(dialog);
+    auto *games = new QListWidget(dialog);
+    layout->addWidget(summary);
+    layout->addWidget(moves);
+    layout->addWidget(games);
+    dialog->resize(480, 420);
+    dialog->show();
+
+    connect(m_store, &GameStore::positionLoaded, dialog, [key, summary, moves, games](const PositionStats &stats){
+        if(stats.key!=key)
+            return;
+        summary->setText(stats.count==0 ? QString("No stored game reached this position")
+                                        : QString("Reached %1 times").arg(stats.count));
+        moves->clear();
+        for(const PositionMove &m : stats.moves){
+            const auto percent = [&m](int n){ return QString::number(100*n/m.count) + "%"; };
+            moves->addItem(QString("%1  %2 games  white %3, draw %4, black %5")
+                .arg(m.uci.isEmpty() ? QString("(end)") : m.uci).arg(m.count)
+                .arg(percent(m.whiteWins), percent(m.draws), percent(m.blackWins)));
+        }
+        games->clear();
+        for(const GameSummary &g : stats.games)
+            games->addItem(QString("%1  %2 - %3  %4")
+                .arg(QDateTime::fromMSecsSinceEpoch(g.started).toString("yyyy-MM-dd hh:mm"),
+                     g.white, g.black, g.result));
+    });
+    m_store->requestPosition(key, 50);
 }
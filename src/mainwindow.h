@@ -4,14 +4,26 @@
 #include <QMainWindow>
 #include "boardview.h"
 #include <QGraphicsScene>
+#include <QGraphicsRectItem>
+#include <QGraphicsPixmapItem>
+#include <QPixmap>
 #include <QTimer>
-#include <QProcess>
 #include <QPushButton>
 #include <QByteArray>
 #include <QVector>
 #include <QPoint>
 #include <QLabel>
+#include <array>
 #include "chessboard.h"
+#include "nativeengine.h"
+#include "uciengine.h"
+#include "gameclock.h"
+#include "evalbar.h"
+#include "boardoverlay.h"
+#include "pieceanimator.h"
+#include "openingbook.h"
+#include "tablebases.h"
+#include "gamestore.h"
 
 class MainWindow : public QMainWindow
 {
@@ -23,39 +35,74 @@ private slots:
     void startGame();
     void chooseVsAi();
     void chooseOffline();
+    void chooseTablebases();
+    void showHistory();
+    void showPositionGames();
     void updateTimer();
     void redrawBoard();
     void setHighlight(const QVector<QPoint> &moves);
     void requestAiMove();
-    void handleAiOutput();
+    void applyAiMove(const QString &uci);
     void resignGame();
     void onBoardChange();
     void checkGameOver();
+    void onEngineInfo(const UciInfo &info);
 
 private:
     void showMenu();
-    void endGame();
+    void endGame(const QString &result, const QString &termination);
     void updateTimerDisplay();
-    void startAiEngine();
+    QString stockfishPath() const;
+    void applyTablebasePath(const QString &path);
+    QByteArray uciGoCommand() const;
+    void startPondering(const QString &ponder);
+    bool chooseTimeControl();
+    void showEngineInfo();
+    void buildBoardItems();
+    void updateOverlay();
 
 private:
     enum Mode { Off, Offline, VsAi };
     Mode m_mode = Off;
+    enum AiBackend { Stockfish, BuiltIn };
+    AiBackend m_backend = Stockfish;
     QString m_player;
     ChessBoard m_board;
     BoardView *m_view;
     QGraphicsScene *m_scene;
     QTimer m_timer;
-    QVector<QPoint> m_highlight;
-    QProcess *m_ai = nullptr;
-    QByteArray m_aiBuffer;
+    // The scene is built once; moves only touch the piece items of squares
+    // whose contents changed, markers live in the overlay above them
+    std::array<QGraphicsRectItem *, 64> m_squareItems{};
+    std::array<QGraphicsPixmapItem *, 64> m_pieceItems{};
+    std::array<ChessBoard::Piece, 64> m_shownPieces{};
+    std::array<QPixmap, 13> m_piecePixmaps; // by ChessBoard::Piece
+    BoardOverlay *m_overlay = nullptr;
+    PieceAnimator *m_animator = nullptr;
+    UciEngine *m_uci = nullptr;
+    QString m_ponderMove; // reply the engine is pondering on, if any
+    NativeEngine *m_engine = nullptr;
+    OpeningBook m_book;
+    bool m_inBook = false; // no book miss yet this game
+    qint64 m_aiRequested = 0; // Trace::start() of the pending AI move
+    Tablebases m_tablebases;
+    QString m_tablebaseResult; // for the position on the board, if the tables have it
+    GameStore *m_store = nullptr;
+    int m_storedGame = 0; // GameStore handle of the game being played
     bool m_backToLogin = false;
     ChessBoard::Color m_playerColor = ChessBoard::White;
-    int m_whiteTime = 600; // 10 minutes
-    int m_blackTime = 600;
+    GameClock m_clock;
+    GameClock::TimeControl m_timeControl;
     QLabel *m_whiteLabel = nullptr;
     QLabel *m_blackLabel = nullptr;
     QPushButton *m_resignBtn = nullptr;
+    QPushButton *m_positionBtn = nullptr;
+    EvalBar *m_evalBar = nullptr;
+    QLabel *m_pvLabel = nullptr;
+    // Engines report far more often than is worth repainting; the latest
+    // report is kept and shown on the next display tick
+    UciInfo m_lastInfo;
+    bool m_infoPending = false;
 
 public:
     bool backToLoginRequested() const { return m_backToLogin; }
@@ -0,0 +1,332 @@
+// Command-line engine match: plays two engines against each other on many
+// boards at once, each game refereed by ChessBoard, and reports the score,
+// the Elo difference and an optional SPRT verdict as games finish.
+#include "matchgame.h"
+#include "matchplayer.h"
+#include "pgn.h"
+#include "sprt.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Two players per board, one for each engine, so a board never waits for
+// an engine process another board is using
+struct Board
+{
+    MatchPlayer *first = nullptr;
+    MatchPlayer *second = nullptr;
+    MatchGame *game = nullptr;
+    int number = 0;           // 1-based game being played
+    bool firstIsWhite = true;
+};
+
+// FEN or EPD lines, or the games of a PGN file whose moves are the opening
+bool loadOpenings(const QString &path, std::vector<Opening> &openings, QString &error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    ChessBoard board;
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix=="epd" || suffix=="fen") {
+        for (const QByteArray &line : data.split('\n')) {
+            // EPD has four fields before its operations; FEN adds the counters
+            const QList<QByteArray> fields = line.simplified().split(' ');
+            if (fields.size()<4)
+                continue;
+            std::string fen;
+            for (int i = 0; i < std::min<int>(6, int(fields.size())); ++i) {
+                if (i>=4 && (fields[i].isEmpty() || !std::isdigit(static_cast<unsigned char>(fields[i][0]))))
+                    break;
+                fen += (i ? " " : "") + fields[i].toStdString();
+            }
+            if (board.setFen(fen) && board.hasMoves(board.currentColor()))
+                openings.push_back({fen, {}});
+        }
+    } else {
+        std::vector<std::string_view> games;
+        Pgn::splitGames(std::string_view(data.constData(), std::size_t(data.size())), true, games);
+        for (std::string_view game : games) {
+            Opening opening;
+            opening.fen = std::string(Pgn::tag(game, "FEN"));
+            const Pgn::Replay r = Pgn::replay(game, board, [&opening](const ChessBoard &, Move m) {
+                opening.moves.push_back(ChessBoard::toUci(m));
+            });
+            if (r.error.empty() && board.hasMoves(board.currentColor()))
+                openings.push_back(std::move(opening));
+        }
+    }
+    if (openings.empty()) {
+        error = "no usable openings";
+        return false;
+    }
+    return true;
+}
+
+// Time control as "base+increment" in seconds, e.g. "10+0.1"
+bool parseTimeControl(const QString &text, GameClock::TimeControl &tc)
+{
+    const QStringList parts = text.split('+');
+    bool ok = false, incOk = true;
+    const double base = parts.value(0).toDouble(&ok);
+    const double inc = parts.size()>1 ? parts[1].toDouble(&incOk) : 0.0;
+    if (!ok || !incOk || base<=0 || inc<0 || parts.size()>2)
+        return false;
+    tc.base = qint64(base * 1000);
+    tc.increment = qint64(inc * 1000);
+    tc.delay = 0;
+    return true;
+}
+
+void writePgn(QFile &out, const MatchGame &game, const QString &white, const QString &black,
+              const QString &tc, const QString &result, const QString &termination, int round)
+{
+    const Opening &opening = game.opening();
+    ChessBoard board;
+    if (!opening.fen.empty())
+        board.setFen(opening.fen);
+    const ChessBoard::Color first = board.currentColor();
+    const std::string fen = board.toFen();
+    const int firstMove = std::stoi(fen.substr(fen.rfind(' ') + 1));
+
+    QByteArray text;
+    const auto tag = [&text](const char *name, const QString &value) {
+        text += '[' + QByteArray(name) + " \"" + value.toUtf8() + "\"]\n";
+    };
+    tag("Event", "chessqt match");
+    tag("Date", QDateTime::currentDateTime().toString("yyyy.MM.dd"));
+    tag("Round", QString::number(round));
+    tag("White", white);
+    tag("Black", black);
+    tag("Result", result);
+    tag("TimeControl", tc);
+    tag("Termination", termination);
+    if (!opening.fen.empty()) {
+        tag("SetUp", "1");
+        tag("FEN", QString::fromStdString(opening.fen));
+    }
+    text += '\n';
+
+    QByteArray line;
+    const std::vector<std::string> &moves = game.board().history();
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+        QByteArray token;
+        const bool white = (i % 2==0)==(first==ChessBoard::White);
+        const int number = firstMove + int((i + (first==ChessBoard::White ? 0 : 1)) / 2);
+        if (white)
+            token = QByteArray::number(number) + ". ";
+        else if (i==0)
+            token = QByteArray::number(number) + "... ";
+        const Move m = board.parseUci(moves[i]);
+        token += QByteArray::fromStdString(Pgn::toSan(board, m));
+        ChessBoard::Undo undo;
+        board.makeMove(m, undo);
+        if (line.size() + token.size() > 79) {
+            text += line + '\n';
+            line.clear();
+        } else if (!line.isEmpty()) {
+            line += ' ';
+        }
+        line += token;
+    }
+    if (line.size() + result.size() > 79) {
+        text += line + '\n';
+        line.clear();
+    } else if (!line.isEmpty()) {
+        line += ' ';
+    }
+    text += line + result.toUtf8() + "\n\n";
+    out.write(text);
+    out.flush();
+}
+
+QString playerName(const QString &program)
+{
+    return program=="builtin" ? QString("Built-in") : QFileInfo(program).fileName();
+}
+
+MatchPlayer::Options parseOptions(const QStringList &values, const QString &threads, const QString &hash)
+{
+    MatchPlayer::Options options{{"Threads", threads.toUtf8()}, {"Hash", hash.toUtf8()}};
+    for (const QString &value : values) {
+        const int eq = int(value.indexOf('='));
+        if (eq>0)
+            options.append({value.left(eq).toUtf8(), value.mid(eq + 1).toUtf8()});
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Trace::Session traceSession;
+    QCoreApplication::setApplicationName("chessqt_match");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays two engines against each other on several boards at once.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("engine1", "UCI engine executable, or \"builtin\".");
+    parser.addPositionalArgument("engine2", "UCI engine executable, or \"builtin\".");
+    QCommandLineOption gamesOpt({"n", "games"}, "Games to play, at most.", "n", "100");
+    QCommandLineOption concurrencyOpt({"c", "concurrency"}, "Games played at the same time.", "n",
+                                      QString::number(std::max(1, QThread::idealThreadCount())));
+    QCommandLineOption tcOpt("tc", "Time control, base+increment in seconds.", "tc", "10+0.1");
+    QCommandLineOption openingsOpt("openings", "Openings: PGN games, or FEN/EPD lines in a .fen/.epd file.", "file");
+    QCommandLineOption threadsOpt("threads", "Search threads per engine.", "n", "1");
+    QCommandLineOption hashOpt("hash", "Hash table per engine in megabytes.", "mb", "16");
+    QCommandLineOption option1Opt("option1", "UCI option for engine 1, as name=value. May be repeated.", "option");
+    QCommandLineOption option2Opt("option2", "UCI option for engine 2, as name=value. May be repeated.", "option");
+    QCommandLineOption name1Opt("name1", "Name of engine 1 in the output.", "name");
+    QCommandLineOption name2Opt("name2", "Name of engine 2 in the output.", "name");
+    QCommandLineOption sprtOpt("sprt", "Stop once the SPRT of elo0 against elo1 is decided.");
+    QCommandLineOption elo0Opt("elo0", "Elo difference of the SPRT null hypothesis.", "elo", "0");
+    QCommandLineOption elo1Opt("elo1", "Elo difference of the SPRT alternative hypothesis.", "elo", "5");
+    QCommandLineOption alphaOpt("alpha", "SPRT false positive rate.", "p", "0.05");
+    QCommandLineOption betaOpt("beta", "SPRT false negative rate.", "p", "0.05");
+    QCommandLineOption pgnOpt("pgn", "Append the finished games to <file>.", "file");
+    parser.addOptions({gamesOpt, concurrencyOpt, tcOpt, openingsOpt, threadsOpt, hashOpt, option1Opt, option2Opt,
+                       name1Opt, name2Opt, sprtOpt, elo0Opt, elo1Opt, alphaOpt, betaOpt, pgnOpt});
+    parser.process(app);
+
+    const QStringList engines = parser.positionalArguments();
+    if (engines.size()!=2)
+        parser.showHelp(2);
+    GameClock::TimeControl tc;
+    if (!parseTimeControl(parser.value(tcOpt), tc)) {
+        std::fprintf(stderr, "invalid time control %s\n", qPrintable(parser.value(tcOpt)));
+        return 2;
+    }
+    std::vector<Opening> openings;
+    if (parser.isSet(openingsOpt)) {
+        QString error;
+        if (!loadOpenings(parser.value(openingsOpt), openings, error)) {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(openingsOpt)), qPrintable(error));
+            return 2;
+        }
+    } else {
+        openings.push_back({});
+    }
+    QFile pgn(parser.value(pgnOpt));
+    if (parser.isSet(pgnOpt) && !pgn.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(pgn.fileName()), qPrintable(pgn.errorString()));
+        return 2;
+    }
+
+    QString name1 = parser.isSet(name1Opt) ? parser.value(name1Opt) : playerName(engines[0]);
+    QString name2 = parser.isSet(name2Opt) ? parser.value(name2Opt) : playerName(engines[1]);
+    if (name1==name2) {
+        name1 += " (1)";
+        name2 += " (2)";
+    }
+    const MatchPlayer::Options options1 = parseOptions(parser.values(option1Opt), parser.value(threadsOpt),
+                                                       parser.value(hashOpt));
+    const MatchPlayer::Options options2 = parseOptions(parser.values(option2Opt), parser.value(threadsOpt),
+                                                       parser.value(hashOpt));
+    const int totalGames = std::max(1, parser.value(gamesOpt).toInt());
+    const bool useSprt = parser.isSet(sprtOpt);
+    const Sprt sprt(parser.value(elo0Opt).toDouble(), parser.value(elo1Opt).toDouble(),
+                    parser.value(alphaOpt).toDouble(), parser.value(betaOpt).toDouble());
+
+    // Each opening is played twice with colours swapped, so an unbalanced
+    // opening favours neither engine
+    MatchScore score; // engine 1's point of view
+    int started = 0, finished = 0;
+    bool stopping = false;
+    QElapsedTimer clock;
+    std::vector<Board> boards(std::size_t(std::min(totalGames, std::max(1, parser.value(concurrencyOpt).toInt()))));
+
+    const auto report = [&] {
+        const double hours = clock.elapsed() / 3600000.0;
+        std::printf("Score of %s vs %s: %d - %d - %d [%.3f] %d\n", qPrintable(name1), qPrintable(name2),
+                    score.wins, score.losses, score.draws, score.score(), score.games());
+        std::printf("Elo difference: %.1f +/- %.1f, games/hour: %.0f\n", score.elo(), score.eloMargin(),
+                    hours>0 ? finished / hours : 0.0);
+        if (useSprt)
+            std::printf("SPRT: llr %.2f (%.2f, %.2f), elo0 %s, elo1 %s\n", sprt.llr(score), sprt.lowerBound(),
+                        sprt.upperBound(), qPrintable(parser.value(elo0Opt)), qPrintable(parser.value(elo1Opt)));
+        std::fflush(stdout);
+    };
+
+    std::function<void(Board &)> startNext = [&](Board &b) {
+        if (stopping || started>=totalGames) {
+            const bool idle = std::none_of(boards.cbegin(), boards.cend(),
+                                           [](const Board &x) { return x.game->isRunning(); });
+            if (idle)
+                app.exit(0);
+            return;
+        }
+        b.number = ++started;
+        b.firstIsWhite = b.number % 2==1;
+        const Opening &opening = openings[std::size_t((b.number - 1) / 2) % openings.size()];
+        if (b.firstIsWhite)
+            b.game->start(b.first, b.second, opening, tc);
+        else
+            b.game->start(b.second, b.first, opening, tc);
+    };
+
+    for (Board &b : boards) {
+        b.first = new MatchPlayer(engines[0], options1, &app);
+        b.second = new MatchPlayer(engines[1], options2, &app);
+        b.game = new MatchGame(&app);
+        b.first->start();
+        b.second->start();
+        QObject::connect(b.game, &MatchGame::finished, &app, [&, board = &b](const QString &result, const QString &termination) {
+            ++finished;
+            const QString white = board->firstIsWhite ? name1 : name2;
+            const QString black = board->firstIsWhite ? name2 : name1;
+            std::printf("Finished game %d (%s vs %s): %s {%s}\n", board->number, qPrintable(white),
+                        qPrintable(black), qPrintable(result), qPrintable(termination));
+            if (result=="1/2-1/2")
+                ++score.draws;
+            else if ((result=="1-0")==board->firstIsWhite)
+                ++score.wins;
+            else
+                ++score.losses;
+            if (pgn.isOpen())
+                writePgn(pgn, *board->game, white, black, parser.value(tcOpt), result, termination, board->number);
+            report();
+            if (termination.startsWith("engine failure") && !stopping) {
+                // The board cannot go on without the engine
+                stopping = true;
+                for (Board &other : boards)
+                    other.game->abort();
+            }
+            if (useSprt && !stopping && sprt.decide(score)!=Sprt::Continue) {
+                stopping = true;
+                std::printf("SPRT: %s accepted\n", sprt.decide(score)==Sprt::AcceptH1 ? "H1" : "H0");
+                // Games still running would only blur the decision
+                for (Board &other : boards)
+                    other.game->abort();
+            }
+            // Started from the event loop: this runs inside the game's last move
+            QMetaObject::invokeMethod(&app, [&, board] { startNext(*board); }, Qt::QueuedConnection);
+        });
+    }
+
+    clock.start();
+    for (Board &b : boards)
+        startNext(b);
+    const int status = app.exec();
+
+    std::printf("Games: %d\nTime: %.1f s\n", finished, clock.elapsed() / 1000.0);
+    report();
+    return status;
+}
@@ -0,0 +1,118 @@
+#include "matchgame.h"
+#include "matchplayer.h"
+
+MatchGame::MatchGame(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_clock, &GameClock::flagFell, this, [this](ChessBoard::Color c) {
+        if (m_running)
+            finish(c==ChessBoard::White ? "0-1" : "1-0", "time forfeit");
+    });
+}
+
+void MatchGame::start(MatchPlayer *white, MatchPlayer *black, const Opening &opening,
+                      const GameClock::TimeControl &tc)
+{
+    for (MatchPlayer *p : {m_white, m_black}) {
+        if (p)
+            disconnect(p, nullptr, this, nullptr);
+    }
+    m_white = white;
+    m_black = black;
+    m_opening = opening;
+    m_enginePlies = 0;
+    for (MatchPlayer *p : {m_white, m_black}) {
+        connect(p, &MatchPlayer::bestMove, this, [this, p](const QString &uci) { onBestMove(p, uci); });
+        connect(p, &MatchPlayer::failed, this, [this, p](const QString &reason) { onFailed(p, reason); });
+        p->newGame();
+    }
+
+    // Openings are checked when they are loaded
+    m_board.reset();
+    if (!opening.fen.empty())
+        m_board.setFen(opening.fen);
+    for (const std::string &uci : opening.moves)
+        m_board.move(m_board.parseUci(uci));
+
+    m_running = true;
+    m_clock.reset(tc);
+    if (checkEnd())
+        return;
+    m_clock.start(m_board.currentColor());
+    requestMove();
+}
+
+void MatchGame::abort()
+{
+    if (!m_running)
+        return;
+    m_running = false;
+    m_clock.stop();
+    m_white->stop();
+    m_black->stop();
+}
+
+void MatchGame::requestMove()
+{
+    const GameClock::TimeControl &tc = m_clock.timeControl();
+    player(m_board.currentColor())->go(m_board, m_clock.remaining(ChessBoard::White),
+                                       m_clock.remaining(ChessBoard::Black), tc.increment);
+}
+
+void MatchGame::onBestMove(MatchPlayer *p, const QString &uci)
+{
+    const ChessBoard::Color side = m_board.currentColor();
+    if (!m_running || p!=player(side))
+        return;
+    const QString winner = side==ChessBoard::White ? "0-1" : "1-0";
+    // The flag timer may not have fired yet when the answer is late
+    if (m_clock.remaining(side)<=0) {
+        finish(winner, "time forfeit");
+        return;
+    }
+    const Move m = m_board.parseUci(uci.toStdString());
+    if (m.isNull() || !m_board.move(m)) {
+        finish(winner, "illegal move " + uci);
+        return;
+    }
+    ++m_enginePlies;
+    m_clock.switchTo(m_board.currentColor());
+    if (!checkEnd())
+        requestMove();
+}
+
+void MatchGame::onFailed(MatchPlayer *p, const QString &reason)
+{
+    if (!m_running)
+        return;
+    finish(p==m_white ? "0-1" : "1-0", "engine failure: " + reason);
+}
+
+bool MatchGame::checkEnd()
+{
+    const ChessBoard::Color side = m_board.currentColor();
+    if (!m_board.hasMoves(side)) {
+        if (m_board.isInCheck(side))
+            finish(side==ChessBoard::White ? "0-1" : "1-0", "checkmate");
+        else
+            finish("1/2-1/2", "stalemate");
+    } else if (m_board.isThreefoldRepetition()) {
+        finish("1/2-1/2", "threefold repetition");
+    } else if (m_board.isInsufficientMaterial()) {
+        finish("1/2-1/2", "insufficient material");
+    } else if (m_board.halfmoveClock()>=100) {
+        finish("1/2-1/2", "fifty-move rule");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void MatchGame::finish(const QString &result, const QString &termination)
+{
+    m_running = false;
+    m_clock.stop();
+    m_white->stop();
+    m_black->stop();
+    emit finished(result, termination);
+}
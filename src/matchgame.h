@@ -0,0 +1,63 @@
+#ifndef MATCHGAME_H
+#define MATCHGAME_H
+
+#include <QObject>
+#include <QString>
+#include <string>
+#include <vector>
+#include "chessboard.h"
+#include "gameclock.h"
+
+class MatchPlayer;
+
+// Start of a match game: a FEN (empty for the initial position) and moves
+// played from it before the engines take over
+struct Opening
+{
+    std::string fen;
+    std::vector<std::string> moves;
+};
+
+// Referee for one game between two players. The board decides legality
+// and every ending a game can reach on its own; the clock forfeits a side
+// whose time runs out. Illegal moves and engine failures lose the game.
+class MatchGame : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MatchGame(QObject *parent = nullptr);
+
+    // Players must stay alive until finished() or abort()
+    void start(MatchPlayer *white, MatchPlayer *black, const Opening &opening,
+               const GameClock::TimeControl &tc);
+    // Ends the game without a result
+    void abort();
+    bool isRunning() const { return m_running; }
+
+    const ChessBoard &board() const { return m_board; }
+    const Opening &opening() const { return m_opening; }
+    // Plies played by the engines, after the opening
+    int enginePlies() const { return m_enginePlies; }
+
+signals:
+    void finished(const QString &result, const QString &termination);
+
+private:
+    void requestMove();
+    void onBestMove(MatchPlayer *player, const QString &uci);
+    void onFailed(MatchPlayer *player, const QString &reason);
+    void finish(const QString &result, const QString &termination);
+    // Result of the game if the position on the board ends it
+    bool checkEnd();
+    MatchPlayer *player(ChessBoard::Color c) const { return c==ChessBoard::White ? m_white : m_black; }
+
+    ChessBoard m_board;
+    GameClock m_clock;
+    Opening m_opening;
+    MatchPlayer *m_white = nullptr;
+    MatchPlayer *m_black = nullptr;
+    bool m_running = false;
+    int m_enginePlies = 0;
+};
+
+#endif // MATCHGAME_H
@@ -0,0 +1,70 @@
+#include "matchplayer.h"
+#include "nativeengine.h"
+#include "uciengine.h"
+#include <QDebug>
+
+MatchPlayer::MatchPlayer(const QString &program, const Options &options, QObject *parent)
+    : QObject(parent)
+{
+    if (program=="builtin") {
+        m_native = new NativeEngine(this);
+        for (const auto &option : options) {
+            if (option.first=="Threads")
+                m_native->setThreads(option.second.toInt());
+            else if (option.first=="Hash")
+                m_native->setHash(option.second.toInt());
+            else if (option.first=="EvalFile") {
+                const QString file = QString::fromUtf8(option.second);
+                QString error;
+                if (!m_native->setEvalFile(file, &error))
+                    qWarning() << "Cannot load network" << file << error;
+            }
+        }
+        connect(m_native, &NativeEngine::bestMove, this, &MatchPlayer::bestMove);
+        return;
+    }
+    m_uci = new UciEngine(this);
+    m_uci->setProgram(program);
+    for (const auto &option : options)
+        m_uci->setOption(option.first, option.second);
+    connect(m_uci, &UciEngine::bestMove, this, [this](const QString &move) { emit bestMove(move); });
+    connect(m_uci, &UciEngine::failed, this, &MatchPlayer::failed);
+}
+
+void MatchPlayer::start()
+{
+    if (m_uci)
+        m_uci->start();
+}
+
+void MatchPlayer::newGame()
+{
+    if (m_uci)
+        m_uci->newGame();
+    else
+        m_native->newGame();
+}
+
+void MatchPlayer::go(const ChessBoard &board, qint64 whiteTime, qint64 blackTime, qint64 increment)
+{
+    if (m_native) {
+        SearchLimits limits;
+        limits.time[ChessBoard::White] = whiteTime;
+        limits.time[ChessBoard::Black] = blackTime;
+        limits.increment[ChessBoard::White] = increment;
+        limits.increment[ChessBoard::Black] = increment;
+        m_native->go(board, limits);
+        return;
+    }
+    m_uci->go(QByteArray::fromStdString(board.uciPosition()),
+              "go wtime " + QByteArray::number(whiteTime) + " btime " + QByteArray::number(blackTime)
+              + " winc " + QByteArray::number(increment) + " binc " + QByteArray::number(increment));
+}
+
+void MatchPlayer::stop()
+{
+    if (m_uci)
+        m_uci->stop();
+    else
+        m_native->stop();
+}
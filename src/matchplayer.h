@@ -0,0 +1,43 @@
+#ifndef MATCHPLAYER_H
+#define MATCHPLAYER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include "chessboard.h"
+
+class NativeEngine;
+class UciEngine;
+
+// One side of an engine match: an external UCI engine or the built-in one
+// behind the same calls, so the referee does not care which it is.
+class MatchPlayer : public QObject
+{
+    Q_OBJECT
+public:
+    using Options = QList<QPair<QByteArray, QByteArray>>;
+
+    // "builtin" selects the built-in engine, anything else is the path of
+    // a UCI executable. Threads and Hash are understood by both; EvalFile
+    // selects the built-in engine's network, ":/nets/default.nnue" being
+    // the embedded one.
+    MatchPlayer(const QString &program, const Options &options, QObject *parent = nullptr);
+
+    void start();
+    void newGame();
+    // Searches the board's position on the given clock, in milliseconds
+    void go(const ChessBoard &board, qint64 whiteTime, qint64 blackTime, qint64 increment);
+    void stop();
+
+signals:
+    void bestMove(const QString &uci);
+    void failed(const QString &reason);
+
+private:
+    UciEngine *m_uci = nullptr;
+    NativeEngine *m_native = nullptr;
+};
+
+#endif // MATCHPLAYER_H
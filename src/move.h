@@ -0,0 +1,73 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <array>
+#include <cstdint>
+
+// A move packed into 16 bits: origin square (bits 0-5), target square
+// (6-11), promotion piece (12-13) and kind (14-15). Squares use ChessBoard's
+// row*8+col indexing. The all-zero value (a8a8) serves as the null move.
+class Move
+{
+public:
+    enum Kind : std::uint16_t { Normal = 0, Promotion = 1 << 14, EnPassant = 2 << 14, Castling = 3 << 14 };
+    enum PromotionPiece { Knight, Bishop, Rook, Queen };
+
+    constexpr Move() = default;
+    constexpr Move(int from, int to, Kind kind = Normal, PromotionPiece promo = Knight)
+        : m_data(std::uint16_t(from | (to << 6) | (promo << 12) | kind))
+    {
+    }
+
+    static constexpr Move fromRaw(std::uint16_t raw)
+    {
+        Move m;
+        m.m_data = raw;
+        return m;
+    }
+
+    constexpr int from() const { return m_data & 0x3F; }
+    constexpr int to() const { return (m_data >> 6) & 0x3F; }
+    constexpr Kind kind() const { return Kind(m_data & (3 << 14)); }
+    constexpr PromotionPiece promotion() const { return PromotionPiece((m_data >> 12) & 3); }
+    constexpr std::uint16_t raw() const { return m_data; }
+    constexpr bool isNull() const { return m_data==0; }
+
+    constexpr bool operator==(const Move &o) const { return m_data==o.m_data; }
+    constexpr bool operator!=(const Move &o) const { return m_data!=o.m_data; }
+
+private:
+    std::uint16_t m_data = 0;
+};
+
+// Fixed-capacity move container that lives on the stack. 256 is above the
+// 218 moves of the richest known legal position.
+class MoveList
+{
+public:
+    static constexpr int Capacity = 256;
+
+    void push(Move m) { m_moves[m_size++] = m; }
+    void clear() { m_size = 0; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size==0; }
+    Move &operator[](int i) { return m_moves[i]; }
+    const Move &operator[](int i) const { return m_moves[i]; }
+    Move *begin() { return m_moves.data(); }
+    Move *end() { return m_moves.data() + m_size; }
+    const Move *begin() const { return m_moves.data(); }
+    const Move *end() const { return m_moves.data() + m_size; }
+    bool contains(Move m) const
+    {
+        for (int i = 0; i < m_size; ++i)
+            if (m_moves[i]==m)
+                return true;
+        return false;
+    }
+
+private:
+    std::array<Move, Capacity> m_moves;
+    int m_size = 0;
+};
+
+#endif // MOVE_H
@@ -0,0 +1,115 @@
+#include "nativeengine.h"
+#include "nnue.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMetaObject>
+#include <algorithm>
+#include <cstdlib>
+
+NativeEngine::NativeEngine(QObject *parent)
+    : QObject(parent)
+{
+    // A network next to the executable replaces the hand-written
+    // evaluation. The embedded default is only used when asked for: it is
+    // the bootstrap net, a copy of the evaluation rather than a trained one.
+    setEvalFile(localNetwork());
+
+    // search() clears the stop flag on entry, so a stop() that lands before
+    // the worker gets there is re-applied after the first iteration.
+    m_searcher.onIteration = [this](const SearchResult &result) {
+        if (m_abort.load(std::memory_order_relaxed)) {
+            m_searcher.stop();
+            return;
+        }
+        UciInfo info;
+        info.depth = result.depth;
+        info.hasScore = true;
+        if (std::abs(result.score)>=MateBound) {
+            const int moves = (MateScore - std::abs(result.score) + 1) / 2;
+            info.isMate = true;
+            info.score = result.score>0 ? moves : -moves;
+        } else {
+            info.score = result.score;
+        }
+        info.nodes = qint64(result.nodes);
+        info.time = result.time;
+        info.nps = result.time>0 ? info.nodes * 1000 / result.time : 0;
+        for (Move m : result.pv)
+            info.pv << QString::fromStdString(ChessBoard::toUci(m));
+        const int generation = m_searchGeneration;
+        QMetaObject::invokeMethod(this, [this, info, generation] {
+            if (generation==m_generation)
+                emit this->info(info);
+        }, Qt::QueuedConnection);
+    };
+}
+
+NativeEngine::~NativeEngine()
+{
+    stop();
+}
+
+void NativeEngine::go(const ChessBoard &board, const SearchLimits &limits)
+{
+    stop();
+    const int generation = ++m_generation;
+    m_searchGeneration = generation;
+    m_abort.store(false, std::memory_order_relaxed);
+    m_thread = std::thread([this, board, limits, generation] {
+        Trace::setThreadName("search");
+        SearchResult result = m_searcher.search(board, limits);
+        QString uci = result.best.isNull() ? QString() : QString::fromStdString(ChessBoard::toUci(result.best));
+        // Results of searches superseded by stop() or a newer go() are dropped
+        QMetaObject::invokeMethod(this, [this, uci, generation] {
+            if (generation==m_generation && !uci.isEmpty())
+                emit bestMove(uci);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void NativeEngine::stop()
+{
+    ++m_generation;
+    if (m_thread.joinable()) {
+        m_abort.store(true, std::memory_order_relaxed);
+        m_searcher.stop();
+        m_thread.join();
+    }
+}
+
+void NativeEngine::setThreads(int count)
+{
+    stop();
+    m_searcher.setThreads(count);
+}
+
+void NativeEngine::setHash(int megabytes)
+{
+    stop();
+    m_tt.resize(std::size_t(std::max(1, megabytes)));
+}
+
+bool NativeEngine::setEvalFile(const QString &file, QString *error)
+{
+    stop();
+    // Engines sharing a file do not reload it under each other's searches
+    if (!file.isEmpty() && file!=Nnue::networkFile() && !Nnue::load(file, error)) {
+        m_searcher.setUseNetwork(false);
+        return false;
+    }
+    m_searcher.setUseNetwork(!file.isEmpty());
+    return true;
+}
+
+QString NativeEngine::localNetwork()
+{
+    const QString local = QCoreApplication::applicationDirPath() + "/chessqt.nnue";
+    return QFile::exists(local) ? local : QString();
+}
+
+void NativeEngine::newGame()
+{
+    stop();
+    m_tt.clear();
+}
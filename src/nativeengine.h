@@ -0,0 +1,51 @@
+#ifndef NATIVEENGINE_H
+#define NATIVEENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <thread>
+#include "chessboard.h"
+#include "search.h"
+#include "transposition.h"
+#include "uciinfo.h"
+
+// Built-in alternative to the Stockfish process. Searches run on a worker
+// thread; the result is delivered on the owner's thread through bestMove(),
+// and each completed iteration is reported through info() in the same form
+// as an external engine's.
+class NativeEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NativeEngine(QObject *parent = nullptr);
+    ~NativeEngine() override;
+
+    void go(const ChessBoard &board, const SearchLimits &limits);
+    // Aborts the running search without emitting its result
+    void stop();
+    void newGame();
+    void setThreads(int count);
+    void setHash(int megabytes);
+    // Evaluates with the network in file, or with the hand-written
+    // evaluation when file is empty. The network is shared by the whole
+    // process, so engines asking for different files end up with the last.
+    bool setEvalFile(const QString &file, QString *error = nullptr);
+
+    // chessqt.nnue next to the executable, or empty if there is none
+    static QString localNetwork();
+
+signals:
+    void bestMove(const QString &uci);
+    void info(const UciInfo &info);
+
+private:
+    TranspositionTable m_tt{64};
+    Searcher m_searcher{m_tt};
+    std::thread m_thread;
+    std::atomic<bool> m_abort{false};
+    int m_generation = 0;
+    int m_searchGeneration = 0; // m_generation of the running search, read by the worker
+};
+
+#endif // NATIVEENGINE_H
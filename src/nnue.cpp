@@ -0,0 +1,427 @@
+#include "nnue.h"
+#include "evaluate.h"
+#include <QDataStream>
+#include <QFile>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Nnue {
+
+namespace {
+
+constexpr char Magic[4] = {'C', 'Q', 'N', 'N'};
+constexpr quint32 Version = 2;
+
+Network g_network;
+bool g_loaded = false;
+QString g_file;
+
+using RowFn = void (*)(std::int16_t *acc, const std::int16_t *row);
+using OutputFn = std::int32_t (*)(const std::int16_t *us, const std::int16_t *them,
+                                  const std::int16_t *weights);
+
+struct Kernel
+{
+    const char *name;
+    bool (*supported)();
+    RowFn add;
+    RowFn sub;
+    OutputFn output;
+};
+
+bool always() { return true; }
+
+void addScalar(std::int16_t *acc, const std::int16_t *row)
+{
+    for (int i = 0; i < HiddenSize; ++i)
+        acc[i] += row[i];
+}
+
+void subScalar(std::int16_t *acc, const std::int16_t *row)
+{
+    for (int i = 0; i < HiddenSize; ++i)
+        acc[i] -= row[i];
+}
+
+std::int32_t outputScalar(const std::int16_t *us, const std::int16_t *them, const std::int16_t *weights)
+{
+    std::int32_t sum = 0;
+    for (int i = 0; i < HiddenSize; ++i) {
+        sum += std::clamp<std::int32_t>(us[i], 0, ClipMax) * weights[i];
+        sum += std::clamp<std::int32_t>(them[i], 0, ClipMax) * weights[HiddenSize + i];
+    }
+    return sum;
+}
+
+#ifdef NNUE_X86
+
+// Compiled for the instruction set through target attributes and only
+// called after a CPUID check, so the binary itself stays baseline x86-64.
+
+bool hasAvx2() { return __builtin_cpu_supports("avx2"); }
+bool hasSse41() { return __builtin_cpu_supports("sse4.1"); }
+
+__attribute__((target("avx2")))
+void addAvx2(std::int16_t *acc, const std::int16_t *row)
+{
+    for (int i = 0; i < HiddenSize; i += 16) {
+        auto *a = reinterpret_cast<__m256i *>(acc + i);
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), r));
+    }
+}
+
+__attribute__((target("avx2")))
+void subAvx2(std::int16_t *acc, const std::int16_t *row)
+{
+    for (int i = 0; i < HiddenSize; i += 16) {
+        auto *a = reinterpret_cast<__m256i *>(acc + i);
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+        _mm256_storeu_si256(a, _mm256_sub_epi16(_mm256_loadu_si256(a), r));
+    }
+}
+
+__attribute__((target("avx2")))
+std::int32_t outputAvx2(const std::int16_t *us, const std::int16_t *them, const std::int16_t *weights)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i clip = _mm256_set1_epi16(ClipMax);
+    __m256i sum = zero;
+    const std::int16_t *inputs[2] = {us, them};
+    for (int side = 0; side < 2; ++side) {
+        for (int i = 0; i < HiddenSize; i += 16) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[side] + i));
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + side*HiddenSize + i));
+            x = _mm256_min_epi16(_mm256_max_epi16(x, zero), clip);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, w));
+        }
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("sse4.1")))
+void addSse41(std::int16_t *acc, const std::int16_t *row)
+{
+    for (int i = 0; i < HiddenSize; i += 8) {
+        auto *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), r));
+    }
+}
+
+__attribute__((target("sse4.1")))
+void subSse41(std::int16_t *acc, const std::int16_t *row)
+{
+    for (int i = 0; i < HiddenSize; i += 8) {
+        auto *a = reinterpret_cast<__m128i *>(acc + i);
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        _mm_storeu_si128(a, _mm_sub_epi16(_mm_loadu_si128(a), r));
+    }
+}
+
+__attribute__((target("sse4.1")))
+std::int32_t outputSse41(const std::int16_t *us, const std::int16_t *them, const std::int16_t *weights)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i clip = _mm_set1_epi16(ClipMax);
+    __m128i sum = zero;
+    const std::int16_t *inputs[2] = {us, them};
+    for (int side = 0; side < 2; ++side) {
+        for (int i = 0; i < HiddenSize; i += 8) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(inputs[side] + i));
+            __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + side*HiddenSize + i));
+            x = _mm_min_epi16(_mm_max_epi16(x, zero), clip);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(x, w));
+        }
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+#endif // NNUE_X86
+
+const Kernel Kernels[] = {
+#ifdef NNUE_X86
+    {"avx2", hasAvx2, addAvx2, subAvx2, outputAvx2},
+    {"sse4.1", hasSse41, addSse41, subSse41, outputSse41},
+#endif
+    {"scalar", always, addScalar, subScalar, outputScalar},
+};
+
+const Kernel *bestKernel()
+{
+    for (const Kernel &k : Kernels)
+        if (k.supported())
+            return &k;
+    return &Kernels[std::size(Kernels) - 1];
+}
+
+const Kernel *g_kernel = bestKernel();
+
+int orient(ChessBoard::Color perspective, int sq)
+{
+    return perspective==ChessBoard::White ? sq : sq ^ 56;
+}
+
+int kingSquare(const ChessBoard &board, ChessBoard::Color perspective)
+{
+    Bitboard king = board.pieceMask(perspective==ChessBoard::White ? ChessBoard::WK : ChessBoard::BK);
+    return king ? orient(perspective, Bitboards::lsb(king)) : 0;
+}
+
+// Own pawn..queen are kinds 0-4, the opponent's 5-9 and their king 10; -1
+// for the own king
+int pieceKind(ChessBoard::Color perspective, ChessBoard::Piece p)
+{
+    static constexpr std::array<int, 13> kinds{{-1, 0, 3, 1, 2, 4, -1, 5, 8, 6, 7, 9, 10}};
+    int i = p;
+    if (perspective==ChessBoard::Black && p!=ChessBoard::Empty)
+        i = i<=ChessBoard::WK ? i+6 : i-6;
+    return kinds[i];
+}
+
+int featureIndex(int kingSq, int kind, int orientedSq)
+{
+    return (kingSq*PieceKinds + kind)*64 + orientedSq;
+}
+
+const std::int16_t *weightRow(ChessBoard::Color perspective, int kingSq, ChessBoard::Piece p, int sq)
+{
+    int feature = featureIndex(kingSq, pieceKind(perspective, p), orient(perspective, sq));
+    return g_network.featureWeights.data() + feature*HiddenSize;
+}
+
+void refresh(Accumulator &acc, ChessBoard::Color perspective, const ChessBoard &board)
+{
+    std::int16_t *values = acc.values[perspective].data();
+    std::copy(g_network.featureBias.begin(), g_network.featureBias.end(), values);
+    int kingSq = kingSquare(board, perspective);
+    for (int p = ChessBoard::WP; p <= ChessBoard::BK; ++p) {
+        auto piece = static_cast<ChessBoard::Piece>(p);
+        if (pieceKind(perspective, piece)<0)
+            continue;
+        for (Bitboard b = board.pieceMask(piece); b; )
+            g_kernel->add(values, weightRow(perspective, kingSq, piece, Bitboards::popLsb(b)));
+    }
+}
+
+int output(const Accumulator &acc, ChessBoard::Color sideToMove)
+{
+    std::int32_t sum = g_kernel->output(acc.values[sideToMove].data(), acc.values[1 - sideToMove].data(),
+                                        g_network.outputWeights.data());
+    return (sum + g_network.outputBias) >> OutputShift;
+}
+
+} // namespace
+
+bool load(const QString &path, QString *error)
+{
+    auto fail = [error](const QString &msg) {
+        if (error)
+            *error = msg;
+        return false;
+    };
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(file.errorString());
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    char magic[4];
+    quint32 version = 0, inputs = 0, hidden = 0;
+    if (in.readRawData(magic, 4)!=4 || !std::equal(magic, magic+4, Magic))
+        return fail("not a network file");
+    in >> version >> inputs >> hidden;
+    if (version!=Version || inputs!=Inputs || hidden!=HiddenSize)
+        return fail("unsupported network layout");
+
+    auto net = std::make_unique<Network>();
+    for (std::int16_t &v : net->featureBias)
+        in >> v;
+    for (std::int16_t &v : net->featureWeights)
+        in >> v;
+    for (std::int16_t &v : net->outputWeights)
+        in >> v;
+    in >> net->outputBias;
+    if (in.status()!=QDataStream::Ok || !in.atEnd())
+        return fail("truncated network file");
+
+    setNetwork(*net);
+    g_file = path;
+    return true;
+}
+
+bool save(const QString &path, const Network &net)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData(Magic, 4);
+    out << Version << quint32(Inputs) << quint32(HiddenSize);
+    for (std::int16_t v : net.featureBias)
+        out << v;
+    for (std::int16_t v : net.featureWeights)
+        out << v;
+    for (std::int16_t v : net.outputWeights)
+        out << v;
+    out << net.outputBias;
+    return out.status()==QDataStream::Ok;
+}
+
+bool isLoaded()
+{
+    return g_loaded;
+}
+
+QString networkFile()
+{
+    return g_file;
+}
+
+void setNetwork(const Network &net)
+{
+    g_network = net;
+    g_loaded = true;
+    g_file.clear();
+}
+
+// Each perspective adds up its own side: material and piece-square values
+// of its pieces, and its king's table blended by the phase every piece
+// contributes to. The king's endgame value sits on the opponent king input,
+// which is always present. Values are spread over all hidden units with
+// floor division and offsets, so the units sum to the exact row, and the
+// bias keeps every unit above the clipping floor. The output is the side to
+// move's total minus the other side's, in centipawns.
+std::unique_ptr<Network> bootstrapNetwork()
+{
+    static constexpr std::array<ChessBoard::Piece, 5> types{{
+        ChessBoard::WP, ChessBoard::WN, ChessBoard::WB, ChessBoard::WR, ChessBoard::WQ
+    }};
+    auto floorDiv = [](int a, int b) { return a>=0 ? a/b : -((-a + b - 1)/b); };
+    auto net = std::make_unique<Network>();
+    for (int kingSq = 0; kingSq < 64; ++kingSq) {
+        const int kingEnd = Evaluation::kingSquareValue(kingSq, 0);
+        const int kingSpan = Evaluation::kingSquareValue(kingSq, Evaluation::MaxPhase) - kingEnd;
+        for (int kind = 0; kind < PieceKinds; ++kind) {
+            for (int sq = 0; sq < 64; ++sq) {
+                int v = kingEnd;
+                if (kind<10) {
+                    const ChessBoard::Piece type = types[kind % 5];
+                    const int phase = Evaluation::piecePhase(type);
+                    v = floorDiv(2*kingSpan*phase + Evaluation::MaxPhase, 2*Evaluation::MaxPhase);
+                    if (kind<5)
+                        v += Evaluation::pieceSquareValue(type, sq);
+                }
+                std::int16_t *row = net->featureWeights.data() + featureIndex(kingSq, kind, sq)*HiddenSize;
+                for (int j = 0; j < HiddenSize; ++j)
+                    row[j] = static_cast<std::int16_t>(floorDiv(v + j, HiddenSize));
+            }
+        }
+    }
+    net->featureBias.fill(64);
+    for (int j = 0; j < HiddenSize; ++j) {
+        net->outputWeights[j] = 1 << OutputShift;                 // side to move
+        net->outputWeights[HiddenSize + j] = -(1 << OutputShift); // other side
+    }
+    return net;
+}
+
+QStringList kernels()
+{
+    QStringList names;
+    for (const Kernel &k : Kernels)
+        if (k.supported())
+            names << QString::fromLatin1(k.name);
+    return names;
+}
+
+QString kernel()
+{
+    return QString::fromLatin1(g_kernel->name);
+}
+
+bool selectKernel(const QString &name)
+{
+    for (const Kernel &k : Kernels) {
+        if (name==QLatin1String(k.name) && k.supported()) {
+            g_kernel = &k;
+            return true;
+        }
+    }
+    return false;
+}
+
+void AccumulatorStack::reset(const ChessBoard &board)
+{
+    m_top = 0;
+    refresh(m_stack[0], ChessBoard::White, board);
+    refresh(m_stack[0], ChessBoard::Black, board);
+}
+
+void AccumulatorStack::push(const ChessBoard &after, Move m, const ChessBoard::Undo &undo)
+{
+    m_stack[m_top+1] = m_stack[m_top];
+    Accumulator &acc = m_stack[++m_top];
+
+    const ChessBoard::Color us = after.currentColor()==ChessBoard::White ? ChessBoard::Black : ChessBoard::White;
+    const int from = m.from(), to = m.to();
+    const ChessBoard::Piece placed = after.pieceAt(to);
+    const ChessBoard::Piece moving = m.kind()==Move::Promotion
+        ? (us==ChessBoard::White ? ChessBoard::WP : ChessBoard::BP) : placed;
+    const bool kingMove = moving==ChessBoard::WK || moving==ChessBoard::BK;
+
+    struct Change { ChessBoard::Piece piece; int sq; };
+    Change added[2], removed[2];
+    int addCount = 0, removeCount = 0;
+    removed[removeCount++] = {moving, from};
+    added[addCount++] = {placed, to};
+    if (undo.captured!=ChessBoard::Empty)
+        removed[removeCount++] = {undo.captured, m.kind()==Move::EnPassant ? (us==ChessBoard::White ? to+8 : to-8) : to};
+    if (m.kind()==Move::Castling) {
+        int row = to/8;
+        int rookFrom = to>from ? row*8+7 : row*8+0;
+        int rookTo = to>from ? row*8+5 : row*8+3;
+        removed[removeCount++] = {after.pieceAt(rookTo), rookFrom};
+        added[addCount++] = {after.pieceAt(rookTo), rookTo};
+    }
+
+    for (ChessBoard::Color perspective : {ChessBoard::White, ChessBoard::Black}) {
+        // Every input of a perspective hangs off its own king square; for
+        // the other one the king is an ordinary opposing piece
+        if (kingMove && perspective==us) {
+            refresh(acc, perspective, after);
+            continue;
+        }
+        int kingSq = kingSquare(after, perspective);
+        std::int16_t *values = acc.values[perspective].data();
+        for (int i = 0; i < removeCount; ++i)
+            g_kernel->sub(values, weightRow(perspective, kingSq, removed[i].piece, removed[i].sq));
+        for (int i = 0; i < addCount; ++i)
+            g_kernel->add(values, weightRow(perspective, kingSq, added[i].piece, added[i].sq));
+    }
+}
+
+int AccumulatorStack::evaluate(ChessBoard::Color sideToMove) const
+{
+    return output(m_stack[m_top], sideToMove);
+}
+
+int evaluate(const ChessBoard &board)
+{
+    Accumulator acc;
+    refresh(acc, ChessBoard::White, board);
+    refresh(acc, ChessBoard::Black, board);
+    return output(acc, board.currentColor());
+}
+
+} // namespace Nnue
@@ -0,0 +1,88 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "chessboard.h"
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// Small efficiently-updatable neural network evaluation.
+//
+// Every position is seen from both sides. A perspective has one input per
+// (own king square, piece kind, square) triple, as in HalfKP, with squares
+// flipped for Black so both sides share weights. The kinds are own and
+// opposing pawns to queens plus the opposing king; the own king is only
+// the first index. The active inputs sum into a 16-bit accumulator per
+// perspective, which makes and unmakes update by adding and subtracting
+// weight rows instead of recomputing; an own king move refreshes its
+// perspective. The output is a clipped-ReLU dot product of both
+// accumulators, side to move first.
+namespace Nnue {
+
+constexpr int PieceKinds = 11;
+constexpr int Inputs = 64 * PieceKinds * 64;
+constexpr int HiddenSize = 32;
+constexpr int ClipMax = 511;
+constexpr int OutputShift = 4;
+
+struct Network
+{
+    alignas(64) std::array<std::int16_t, HiddenSize> featureBias{};
+    alignas(64) std::array<std::int16_t, Inputs * HiddenSize> featureWeights{};
+    alignas(64) std::array<std::int16_t, 2 * HiddenSize> outputWeights{};
+    std::int32_t outputBias = 0;
+};
+
+// Bootstrap network compiled into the executables as a resource
+constexpr char DefaultNetwork[] = ":/nets/default.nnue";
+
+// Reads a network file (also ":/" resources). There is one network per
+// process; this must not be called while a search is evaluating.
+bool load(const QString &path, QString *error = nullptr);
+bool save(const QString &path, const Network &net);
+bool isLoaded();
+// File the network was read from; empty for one set in memory
+QString networkFile();
+// Evaluation::evaluate written as a network, as a starting point for
+// training. Each perspective scores its own pieces and king; rounding of
+// the phase-blended king term and the phase clamp leave it about a
+// centipawn off on average.
+std::unique_ptr<Network> bootstrapNetwork();
+void setNetwork(const Network &net);
+
+// SIMD kernels available on this CPU, best first; the best one is used
+// unless another is selected.
+QStringList kernels();
+QString kernel();
+bool selectKernel(const QString &name);
+
+struct alignas(64) Accumulator
+{
+    std::array<std::array<std::int16_t, HiddenSize>, 2> values; // by ChessBoard::Color
+};
+
+// Accumulators along the current search line. push() after makeMove and
+// pop() after unmakeMove keep the top in step with the board; null moves
+// need neither since the pieces do not change.
+class AccumulatorStack
+{
+public:
+    void reset(const ChessBoard &board);
+    void push(const ChessBoard &after, Move m, const ChessBoard::Undo &undo);
+    void pop() { --m_top; }
+    int evaluate(ChessBoard::Color sideToMove) const;
+
+private:
+    static constexpr int Depth = 128;
+    std::array<Accumulator, Depth> m_stack;
+    int m_top = 0;
+};
+
+// Full evaluation without incremental state, from the side to move
+int evaluate(const ChessBoard &board);
+
+} // namespace Nnue
+
+#endif // NNUE_H
@@ -0,0 +1,58 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include "chessboard.h"
+
+// Reader for opening books in the Polyglot .bin layout: 16-byte big-endian
+// records (key, move, weight, learn) sorted by key. The file is memory
+// mapped and looked up by binary search, so opening a book costs nothing
+// and a probe touches a handful of pages.
+//
+// Keys are standard Polyglot keys from the published Random64 table, so
+// books written by other tools and by chessqt_pgn --book are
+// interchangeable.
+class OpeningBook
+{
+public:
+    struct Entry
+    {
+        Move move;
+        int weight = 0;
+    };
+
+    OpeningBook() = default;
+    ~OpeningBook() { close(); }
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return m_data!=nullptr; }
+    qint64 size() const { return m_count; }
+
+    // Legal book moves for the position, highest weight first
+    QVector<Entry> entries(const ChessBoard &board) const;
+    // Weighted random choice among the book moves; a null Move when the
+    // position is not in the book. Every call counts towards the hit rate.
+    Move pick(const ChessBoard &board);
+    int probes() const { return m_probes; }
+    int hits() const { return m_hits; }
+    void resetStats() { m_probes = m_hits = 0; }
+
+    static std::uint64_t key(const ChessBoard &board);
+    // Book encoding of a move, castling written as king takes rook
+    static std::uint16_t encodeMove(Move m);
+
+private:
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_count = 0;
+    int m_probes = 0;
+    int m_hits = 0;
+};
+
+#endif // OPENINGBOOK_H
@@ -0,0 +1,322 @@
+// Command-line perft/divide tool for validating and timing move generation.
+#include "chessboard.h"
+#include "tablebases.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *StartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct Reference
+{
+    const char *fen;
+    std::vector<quint64> nodes; // index 0 holds depth 1
+};
+
+// Standard perft reference positions (start position, "Kiwipete" and
+// positions 3-6 from the Chess Programming Wiki).
+const std::vector<Reference> References{
+    {StartFen, {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48, 2039, 97862, 4085603, 193690690}},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14, 191, 2812, 43238, 674624, 11030083}},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6, 264, 9467, 422333, 15833292}},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44, 1486, 62379, 2103487, 89941194}},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     {46, 2079, 89890, 3894594, 164075551}},
+};
+
+constexpr int AnyDtz = 1 << 30;
+
+struct TablebaseReference
+{
+    const char *fen;
+    Syzygy::Wdl wdl;
+    int dtz;          // plies for the side to move, or AnyDtz
+    const char *move; // the only move that keeps the result, if there is one
+};
+
+// Endgame positions with known results: the longest KQvK and KRvK wins
+// (mate in 10 and 16), king and pawn positions where a single move wins or
+// draws, and the Lucena and Philidor rook endings.
+const std::vector<TablebaseReference> TablebaseReferences{
+    {"k7/8/1K6/8/8/8/8/7R w - - 0 1", Syzygy::Win, 1, "h1h8"},
+    {"K7/1Q6/8/8/5k2/8/8/8 w - - 0 1", Syzygy::Win, 19, nullptr},
+    {"K7/1R6/2k5/8/8/8/8/8 w - - 0 1", Syzygy::Win, 31, nullptr},
+    {"8/8/8/4k3/8/8/8/4KB2 w - - 0 1", Syzygy::Draw, 0, nullptr},
+    {"4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", Syzygy::Win, 3, nullptr},
+    {"4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", Syzygy::Loss, -4, nullptr},
+    {"8/8/8/4k3/8/8/4P3/4K3 w - - 0 1", Syzygy::Draw, 0, nullptr},
+    {"1K6/6k1/8/8/8/4P3/8/8 w - - 0 1", Syzygy::Win, 7, "b8c7"},
+    {"8/8/4p3/8/8/8/6K1/1k6 b - - 0 1", Syzygy::Win, 7, "b1c2"},
+    {"3K4/1k6/8/8/8/4P3/8/8 b - - 0 1", Syzygy::Draw, 0, "b7c6"},
+    {"8/8/8/4k3/8/8/8/4KBN1 w - - 0 1", Syzygy::Win, AnyDtz, nullptr},
+    {"8/8/8/4k3/8/8/8/4KNN1 w - - 0 1", Syzygy::Draw, 0, nullptr},
+    {"7k/r7/8/8/4Q3/8/8/3K4 w - - 0 1", Syzygy::Win, AnyDtz, nullptr},
+    {"1K1k4/1P6/8/8/8/8/r7/2R5 w - - 0 1", Syzygy::Win, AnyDtz, nullptr},
+    {"3k4/8/7r/3PK3/8/8/8/R7 b - - 0 1", Syzygy::Draw, 0, nullptr},
+};
+
+// Shared node-count cache for hashed perft, keyed by the board's Zobrist
+// key. Each slot keeps key^data next to data so a torn write from another
+// thread is detected as a miss instead of needing a lock.
+class PerftHash
+{
+public:
+    explicit PerftHash(std::size_t megabytes)
+        : m_entries(std::max<std::size_t>(1, (megabytes << 20) / sizeof(Entry)))
+    {
+    }
+
+    bool probe(quint64 key, int depth, quint64 &nodes) const
+    {
+        const Entry &e = m_entries[key % m_entries.size()];
+        quint64 data = e.data.load(std::memory_order_relaxed);
+        quint64 check = e.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || int(data & 0xFF) != depth)
+            return false;
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(quint64 key, int depth, quint64 nodes)
+    {
+        Entry &e = m_entries[key % m_entries.size()];
+        quint64 data = (nodes << 8) | quint64(depth);
+        e.check.store(key ^ data, std::memory_order_relaxed);
+        e.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry
+    {
+        std::atomic<quint64> check{0};
+        std::atomic<quint64> data{0};
+    };
+    std::vector<Entry> m_entries;
+};
+
+struct RootMove
+{
+    Move move;
+    quint64 nodes = 0;
+};
+
+quint64 perft(ChessBoard &board, int depth, PerftHash *hash)
+{
+    MoveList moves;
+    board.legalMoves(moves);
+    if (depth==1)
+        return quint64(moves.size());
+
+    quint64 key = board.key();
+    quint64 nodes = 0;
+    if (hash && hash->probe(key, depth, nodes))
+        return nodes;
+    for (Move m : moves) {
+        ChessBoard::Undo undo;
+        board.makeMove(m, undo);
+        nodes += perft(board, depth-1, hash);
+        board.unmakeMove(m, undo);
+    }
+    if (hash)
+        hash->store(key, depth, nodes);
+    return nodes;
+}
+
+// Splits the root moves across worker threads; each worker pulls the next
+// unclaimed root move until none are left and searches it on its own copy
+// of the board.
+quint64 parallelPerft(const ChessBoard &board, int depth, int threads, PerftHash *hash,
+                      QVector<RootMove> *divide = nullptr)
+{
+    if (depth<=0)
+        return 1;
+    MoveList list;
+    board.legalMoves(list);
+    QVector<RootMove> moves;
+    for (Move m : list)
+        moves.append({m});
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        ChessBoard local = board;
+        for (int i = next++; i < moves.size(); i = next++) {
+            ChessBoard::Undo undo;
+            local.makeMove(moves[i].move, undo);
+            moves[i].nodes = depth>1 ? perft(local, depth-1, hash) : 1;
+            local.unmakeMove(moves[i].move, undo);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &t : pool)
+        t.join();
+
+    quint64 total = 0;
+    for (const RootMove &m : moves)
+        total += m.nodes;
+    if (divide)
+        *divide = moves;
+    return total;
+}
+
+double elapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(quint64 nodes, double secs)
+{
+    std::printf("Nodes: %llu\nTime: %.3f s\nNPS: %.0f\n", static_cast<unsigned long long>(nodes),
+                secs, secs>0 ? nodes/secs : 0.0);
+}
+
+int runVerify(int maxDepth, int threads, PerftHash *hash)
+{
+    int failures = 0;
+    quint64 totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Reference &ref : References) {
+        ChessBoard board;
+        board.setFen(ref.fen);
+        std::printf("%s\n", ref.fen);
+        int depths = std::min<int>(maxDepth, int(ref.nodes.size()));
+        for (int d = 1; d <= depths; ++d) {
+            quint64 nodes = parallelPerft(board, d, threads, hash);
+            quint64 expected = ref.nodes[d-1];
+            totalNodes += nodes;
+            std::printf("  depth %d: %llu (expected %llu) %s\n", d,
+                        static_cast<unsigned long long>(nodes),
+                        static_cast<unsigned long long>(expected),
+                        nodes==expected ? "ok" : "FAIL");
+            if (nodes!=expected)
+                ++failures;
+        }
+    }
+    report(totalNodes, elapsedSeconds(start));
+    std::printf("%d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
+
+int runVerifyTablebases(const QString &path)
+{
+    Tablebases tablebases;
+    tablebases.setPath(path);
+    if (tablebases.isEmpty()) {
+        std::fprintf(stderr, "No Syzygy tables (.rtbw) found in %s\n", qPrintable(path));
+        return 2;
+    }
+    int failures = 0;
+    int skipped = 0;
+    const auto check = [&failures](const char *what, bool ok, const std::string &got, const std::string &expected) {
+        std::printf("  %s: %s (expected %s) %s\n", what, got.c_str(), expected.c_str(), ok ? "ok" : "FAIL");
+        if (!ok)
+            ++failures;
+    };
+    for (const TablebaseReference &ref : TablebaseReferences) {
+        ChessBoard board;
+        board.setFen(ref.fen);
+        std::printf("%s\n", ref.fen);
+        if (!tablebases.covers(board)) {
+            std::printf("  no tables, skipped\n");
+            ++skipped;
+            continue;
+        }
+        Syzygy::Wdl wdl = Syzygy::Draw;
+        const bool wdlProbed = tablebases.probeWdl(board, wdl);
+        check("wdl", wdlProbed && wdl==ref.wdl, wdlProbed ? std::to_string(int(wdl)) : "failed", std::to_string(int(ref.wdl)));
+        if (ref.dtz!=AnyDtz) {
+            // Tables that store distances in moves may give one ply less
+            int dtz = 0;
+            const bool dtzProbed = tablebases.probeDtz(board, dtz);
+            const bool ok = dtzProbed && (dtz==ref.dtz || dtz==ref.dtz - (ref.dtz > 0) + (ref.dtz < 0));
+            check("dtz", ok, dtzProbed ? std::to_string(dtz) : "failed", std::to_string(ref.dtz));
+        }
+        if (ref.move) {
+            Syzygy::Prober::RootMove best;
+            const bool rootProbed = tablebases.probeRoot(board, best);
+            const std::string move = rootProbed ? ChessBoard::toUci(best.move) : "failed";
+            check("move", rootProbed && move==ref.move && best.wdl==ref.wdl, move, ref.move);
+        }
+    }
+    std::printf("%d failure(s), %d skipped\n", failures, skipped);
+    return failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Trace::Session traceSession;
+    QCoreApplication::setApplicationName("chessqt_perft");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Counts move-generation leaf nodes from a position.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("depth", "Search depth (default 5).");
+    QCommandLineOption fenOpt({"f", "fen"}, "Start from <fen> instead of the initial position.", "fen");
+    QCommandLineOption divideOpt({"d", "divide"}, "Print the node count below each root move.");
+    QCommandLineOption threadsOpt({"t", "threads"}, "Number of worker threads.", "n",
+                                  QString::number(std::max(1u, std::thread::hardware_concurrency())));
+    QCommandLineOption hashOpt("hash", "Enable hashed perft with a <mb> megabyte table.", "mb");
+    QCommandLineOption verifyOpt("verify", "Check node counts of the reference positions up to depth.");
+    QCommandLineOption verifyTbOpt("verify-tb", "Check probes of known endgames against the Syzygy tables in <dir>.", "dir");
+    parser.addOption(fenOpt);
+    parser.addOption(divideOpt);
+    parser.addOption(threadsOpt);
+    parser.addOption(hashOpt);
+    parser.addOption(verifyOpt);
+    parser.addOption(verifyTbOpt);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    int depth = args.isEmpty() ? 5 : args.first().toInt();
+    int threads = std::max(1, parser.value(threadsOpt).toInt());
+    std::unique_ptr<PerftHash> hash;
+    if (parser.isSet(hashOpt))
+        hash = std::make_unique<PerftHash>(std::max(1, parser.value(hashOpt).toInt()));
+
+    if (parser.isSet(verifyOpt))
+        return runVerify(args.isEmpty() ? 4 : depth, threads, hash.get());
+    if (parser.isSet(verifyTbOpt))
+        return runVerifyTablebases(parser.value(verifyTbOpt));
+
+    ChessBoard board;
+    if (parser.isSet(fenOpt) && !board.setFen(parser.value(fenOpt).toStdString())) {
+        std::fprintf(stderr, "Invalid FEN: %s\n", qPrintable(parser.value(fenOpt)));
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    QVector<RootMove> divide;
+    quint64 nodes = parallelPerft(board, depth, threads, hash.get(),
+                                  parser.isSet(divideOpt) ? &divide : nullptr);
+    double secs = elapsedSeconds(start);
+    if (parser.isSet(divideOpt)) {
+        std::sort(divide.begin(), divide.end(), [](const RootMove &a, const RootMove &b) {
+            return ChessBoard::toUci(a.move) < ChessBoard::toUci(b.move);
+        });
+        for (const RootMove &m : divide)
+            std::printf("%s: %llu\n", ChessBoard::toUci(m.move).c_str(),
+                        static_cast<unsigned long long>(m.nodes));
+        std::printf("\n");
+    }
+    report(nodes, secs);
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "pgn.h"
+#include <cstring>
+
+namespace {
+
+// Piece type of a SAN letter as the white piece; pawns have none
+ChessBoard::Piece sanPiece(char c)
+{
+    switch (c) {
+    case 'N': return ChessBoard::WN;
+    case 'B': return ChessBoard::WB;
+    case 'R': return ChessBoard::WR;
+    case 'Q': return ChessBoard::WQ;
+    case 'K': return ChessBoard::WK;
+    default: return ChessBoard::Empty;
+    }
+}
+
+ChessBoard::Piece whiteOf(ChessBoard::Piece p)
+{
+    return p>=ChessBoard::BP ? ChessBoard::Piece(p - ChessBoard::BP + ChessBoard::WP) : p;
+}
+
+int promotionOf(char c)
+{
+    switch (c) {
+    case 'N': return Move::Knight;
+    case 'B': return Move::Bishop;
+    case 'R': return Move::Rook;
+    case 'Q': return Move::Queen;
+    default: return -1;
+    }
+}
+
+bool isSpace(char c)
+{
+    return c==' ' || c=='\n' || c=='\r' || c=='\t';
+}
+
+} // namespace
+
+namespace Pgn {
+
+Move parseSan(const ChessBoard &board, std::string_view san)
+{
+    // Check, mate and annotation marks carry no move information
+    while (!san.empty() && std::strchr("+#!?", san.back()))
+        san.remove_suffix(1);
+    if (san.size()<2)
+        return Move();
+
+    MoveList moves;
+    board.legalMoves(moves);
+
+    if (san[0]=='O' || san[0]=='0') {
+        const bool longSide = san=="O-O-O" || san=="0-0-0";
+        if (!longSide && san!="O-O" && san!="0-0")
+            return Move();
+        for (Move m : moves)
+            if (m.kind()==Move::Castling && (m.to()%8==2)==longSide)
+                return m;
+        return Move();
+    }
+
+    ChessBoard::Piece piece = sanPiece(san[0]);
+    if (piece!=ChessBoard::Empty)
+        san.remove_prefix(1);
+    else
+        piece = ChessBoard::WP;
+
+    int promotion = -1;
+    if (!san.empty() && promotionOf(san.back())>=0) {
+        promotion = promotionOf(san.back());
+        san.remove_suffix(1);
+        if (!san.empty() && san.back()=='=')
+            san.remove_suffix(1);
+    }
+    if (san.size()<2)
+        return Move();
+    const int toCol = san[san.size()-2] - 'a';
+    const int toRow = '8' - san[san.size()-1];
+    if (toCol<0 || toCol>7 || toRow<0 || toRow>7)
+        return Move();
+    san.remove_suffix(2);
+
+    // What is left is disambiguation and the capture mark
+    int fromCol = -1, fromRow = -1;
+    for (char c : san) {
+        if (c>='a' && c<='h')
+            fromCol = c - 'a';
+        else if (c>='1' && c<='8')
+            fromRow = '8' - c;
+        else if (c!='x' && c!=':' && c!='-')
+            return Move();
+    }
+
+    const int to = toRow*8 + toCol;
+    Move found;
+    for (Move m : moves) {
+        if (m.to()!=to || whiteOf(board.pieceAt(m.from()))!=piece || m.kind()==Move::Castling)
+            continue;
+        if ((fromCol>=0 && m.from()%8!=fromCol) || (fromRow>=0 && m.from()/8!=fromRow))
+            continue;
+        if ((m.kind()==Move::Promotion) != (promotion>=0))
+            continue;
+        if (promotion>=0 && m.promotion()!=promotion)
+            continue;
+        if (!found.isNull())
+            return Move(); // ambiguous
+        found = m;
+    }
+    return found;
+}
+
+std::string toSan(const ChessBoard &board, Move m)
+{
+    std::string san;
+    const ChessBoard::Piece piece = whiteOf(board.pieceAt(m.from()));
+    if (m.kind()==Move::Castling) {
+        san = m.to()%8==2 ? "O-O-O" : "O-O";
+    } else {
+        const bool capture = board.pieceAt(m.to())!=ChessBoard::Empty || m.kind()==Move::EnPassant;
+        if (piece==ChessBoard::WP) {
+            if (capture)
+                san += char('a' + m.from()%8);
+        } else {
+            san += "PRNBQK"[piece - ChessBoard::WP];
+            // Disambiguate by file, then rank, then both
+            MoveList moves;
+            board.legalMoves(moves);
+            bool clash = false, sameCol = false, sameRow = false;
+            for (Move o : moves) {
+                if (o==m || o.to()!=m.to() || whiteOf(board.pieceAt(o.from()))!=piece)
+                    continue;
+                clash = true;
+                sameCol |= o.from()%8==m.from()%8;
+                sameRow |= o.from()/8==m.from()/8;
+            }
+            if (clash && (!sameCol || sameRow))
+                san += char('a' + m.from()%8);
+            if (clash && sameCol)
+                san += char('8' - m.from()/8);
+        }
+        if (capture)
+            san += 'x';
+        san += char('a' + m.to()%8);
+        san += char('8' - m.to()/8);
+        if (m.kind()==Move::Promotion) {
+            san += '=';
+            san += "NBRQ"[m.promotion()];
+        }
+    }
+
+    ChessBoard after = board;
+    ChessBoard::Undo undo;
+    after.makeMove(m, undo);
+    if (after.isInCheck(after.currentColor()))
+        san += after.hasMoves(after.currentColor()) ? '+' : '#';
+    return san;
+}
+
+std::size_t splitGames(std::string_view text, bool atEnd, std::vector<std::string_view> &games)
+{
+    static constexpr std::string_view Marker = "[Event ";
+    std::size_t start = text.rfind(Marker, 0)==0 ? 0 : text.find("\n" + std::string(Marker));
+    if (start==std::string_view::npos)
+        return atEnd ? text.size() : 0;
+    if (text[start]=='\n')
+        ++start;
+    for (;;) {
+        std::size_t next = text.find("\n[Event ", start);
+        if (next==std::string_view::npos) {
+            if (!atEnd)
+                return start;
+            games.push_back(text.substr(start));
+            return text.size();
+        }
+        games.push_back(text.substr(start, next + 1 - start));
+        start = next + 1;
+    }
+}
+
+std::string_view tag(std::string_view game, std::string_view name)
+{
+    std::size_t pos = 0;
+    while (pos<game.size() && game[pos]=='[') {
+        const std::size_t end = game.find('\n', pos);
+        const std::string_view line = game.substr(pos, end==std::string_view::npos ? std::string_view::npos : end - pos);
+        if (line.size()>name.size()+1 && line.substr(1, name.size())==name && line[name.size()+1]==' ') {
+            const std::size_t open = line.find('"');
+            const std::size_t close = line.rfind('"');
+            if (open!=std::string_view::npos && close>open)
+                return line.substr(open + 1, close - open - 1);
+        }
+        if (end==std::string_view::npos)
+            break;
+        pos = end + 1;
+        while (pos<game.size() && isSpace(game[pos]))
+            ++pos;
+    }
+    return {};
+}
+
+Replay replay(std::string_view game, ChessBoard &board)
+{
+    return replay(game, board, [](const ChessBoard &, Move) {});
+}
+
+namespace detail {
+
+std::size_t movetextStart(std::string_view game)
+{
+    std::size_t pos = 0;
+    for (;;) {
+        while (pos<game.size() && isSpace(game[pos]))
+            ++pos;
+        if (pos>=game.size() || game[pos]!='[')
+            return pos;
+        pos = game.find('\n', pos);
+        if (pos==std::string_view::npos)
+            return game.size();
+    }
+}
+
+bool setup(std::string_view game, ChessBoard &board, Replay &r)
+{
+    const std::string_view fen = tag(game, "FEN");
+    if (fen.empty()) {
+        board.reset();
+        return true;
+    }
+    if (!board.setFen(fen)) {
+        r.error = "bad FEN tag";
+        return false;
+    }
+    return true;
+}
+
+bool isResult(std::string_view token)
+{
+    return token=="1-0" || token=="0-1" || token=="1/2-1/2" || token=="*";
+}
+
+std::string_view nextToken(std::string_view text, std::size_t &pos)
+{
+    int depth = 0; // variation nesting
+    while (pos<text.size()) {
+        const char c = text[pos];
+        if (isSpace(c) || c=='.') {
+            ++pos;
+        } else if (c=='{') {
+            const std::size_t end = text.find('}', pos);
+            pos = end==std::string_view::npos ? text.size() : end + 1;
+        } else if (c==';' || (c=='%' && (pos==0 || text[pos-1]=='\n'))) {
+            const std::size_t end = text.find('\n', pos);
+            pos = end==std::string_view::npos ? text.size() : end + 1;
+        } else if (c=='(') {
+            ++depth;
+            ++pos;
+        } else if (c==')') {
+            depth = std::max(0, depth - 1);
+            ++pos;
+        } else {
+            std::size_t end = pos;
+            while (end<text.size() && !isSpace(text[end]) && !std::strchr("{}();", text[end]))
+                ++end;
+            std::string_view token = text.substr(pos, end - pos);
+            pos = end;
+            if (depth>0 || token[0]=='$')
+                continue;
+            // Move numbers, also glued to the move as in "12.e4" or "12...Nf6"
+            if (token[0]>='0' && token[0]<='9' && !isResult(token) && token.rfind("0-0", 0)!=0) {
+                const std::size_t dots = token.find_first_not_of("0123456789");
+                if (dots==std::string_view::npos || token[dots]!='.')
+                    return token; // not a move number, let the caller reject it
+                const std::size_t rest = token.find_first_not_of('.', dots);
+                if (rest==std::string_view::npos)
+                    continue;
+                token.remove_prefix(rest);
+            }
+            return token;
+        }
+    }
+    return {};
+}
+
+} // namespace detail
+
+} // namespace Pgn
@@ -0,0 +1,80 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "chessboard.h"
+
+// PGN reading on raw text, written for bulk imports: nothing here
+// allocates per move, and games are views into the caller's buffer.
+namespace Pgn {
+
+// Standard algebraic notation ("Nbd7", "exd8=Q+", "O-O") resolved against
+// the legal moves of the position; a null Move if it matches none or
+// several.
+Move parseSan(const ChessBoard &board, std::string_view san);
+// SAN of a legal move, with check and mate marks
+std::string toSan(const ChessBoard &board, Move m);
+
+// Splits text into games, each starting at an "[Event " line. Without
+// atEnd the last game may continue past the buffer, so it is left out and
+// the returned offset is where it starts; otherwise the whole text is used.
+std::size_t splitGames(std::string_view text, bool atEnd, std::vector<std::string_view> &games);
+
+// Value of a tag pair such as [FEN "..."], empty if absent
+std::string_view tag(std::string_view game, std::string_view name);
+
+struct Replay
+{
+    int plies = 0;           // moves replayed successfully
+    std::string error;       // empty when the whole game is legal
+    std::string_view result; // "1-0", "0-1", "1/2-1/2" or "*" if given
+};
+
+// Plays the movetext from the starting position (or the FEN tag) on board.
+// Comments, variations, NAGs and move numbers are skipped. onMove, if set,
+// sees each move before it is made.
+template <typename OnMove>
+Replay replay(std::string_view game, ChessBoard &board, OnMove &&onMove);
+Replay replay(std::string_view game, ChessBoard &board);
+
+namespace detail {
+
+// Next SAN or result token of the movetext starting at pos, advancing pos
+std::string_view nextToken(std::string_view text, std::size_t &pos);
+bool isResult(std::string_view token);
+std::size_t movetextStart(std::string_view game);
+bool setup(std::string_view game, ChessBoard &board, Replay &r);
+
+} // namespace detail
+
+template <typename OnMove>
+Replay replay(std::string_view game, ChessBoard &board, OnMove &&onMove)
+{
+    Replay r;
+    if (!detail::setup(game, board, r))
+        return r;
+    std::size_t pos = detail::movetextStart(game);
+    for (std::string_view token = detail::nextToken(game, pos); !token.empty();
+         token = detail::nextToken(game, pos)) {
+        if (detail::isResult(token)) {
+            r.result = token;
+            break;
+        }
+        const Move m = parseSan(board, token);
+        if (m.isNull()) {
+            r.error = "illegal or ambiguous move " + std::string(token) + " at ply " + std::to_string(r.plies + 1);
+            return r;
+        }
+        onMove(board, m);
+        ChessBoard::Undo undo;
+        board.makeMove(m, undo);
+        ++r.plies;
+    }
+    return r;
+}
+
+} // namespace Pgn
+
+#endif // PGN_H
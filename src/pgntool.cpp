@@ -0,0 +1,305 @@
+// Command-line PGN importer: validates every game of an archive by replaying
+// it, and can turn the opening moves into a book for OpeningBook.
+#include "chessboard.h"
+#include "gamedatabase.h"
+#include "openingbook.h"
+#include "pgn.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct BookMove
+{
+    std::uint64_t key;
+    std::uint16_t move;
+    bool operator==(const BookMove &o) const { return key==o.key && move==o.move; }
+};
+
+struct BookMoveHash
+{
+    std::size_t operator()(const BookMove &b) const { return b.key ^ (std::uint64_t(b.move) * 0x9E3779B97F4A7C15ULL); }
+};
+
+using BookCounts = std::unordered_map<BookMove, std::uint32_t, BookMoveHash>;
+
+struct Failure
+{
+    std::uint64_t game;   // 1-based number in the file
+    std::uint64_t offset; // byte offset of the game
+    std::string message;
+};
+
+// A legal game waiting to be stored, kept compact until it is inserted
+struct Imported
+{
+    std::size_t index; // in the window's batch
+    std::vector<std::uint16_t> moves;
+    std::vector<std::uint64_t> keys; // before each move and after the last
+};
+
+// Per-thread results, merged after each window
+struct Tally
+{
+    std::uint64_t games = 0;
+    std::uint64_t plies = 0;
+    std::vector<Failure> failures;
+    BookCounts book;
+    std::vector<Imported> imported;
+};
+
+QString tagValue(std::string_view game, std::string_view name)
+{
+    const std::string_view v = Pgn::tag(game, name);
+    return QString::fromUtf8(v.data(), qsizetype(v.size()));
+}
+
+// Writes a window's legal games in transactions of a few thousand rows
+bool storeGames(GameDatabase &db, const std::vector<std::string_view> &batch,
+                std::vector<Imported> &games, std::uint64_t &rows)
+{
+    std::sort(games.begin(), games.end(), [](const Imported &a, const Imported &b) { return a.index < b.index; });
+    constexpr int GamesPerTransaction = 1000;
+    for (std::size_t i = 0; i < games.size(); i += GamesPerTransaction) {
+        if (!db.begin())
+            return false;
+        for (std::size_t j = i; j < std::min(games.size(), i + GamesPerTransaction); ++j) {
+            const std::string_view text = batch[games[j].index];
+            GameRecord record;
+            record.white = tagValue(text, "White");
+            record.black = tagValue(text, "Black");
+            record.result = tagValue(text, "Result");
+            record.termination = tagValue(text, "Termination");
+            record.timeControl = tagValue(text, "TimeControl");
+            record.startFen = tagValue(text, "FEN");
+            record.moves.reserve(qsizetype(games[j].moves.size()));
+            for (std::uint16_t raw : games[j].moves)
+                record.moves.append({QString::fromStdString(ChessBoard::toUci(Move::fromRaw(raw))), -1});
+            record.keys = QVector<quint64>(games[j].keys.begin(), games[j].keys.end());
+            if (db.addGame(record)==0) {
+                db.rollback();
+                return false;
+            }
+            rows += 1 + games[j].moves.size() + games[j].keys.size();
+        }
+        if (!db.commit())
+            return false;
+    }
+    return true;
+}
+
+double elapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool writeBook(const QString &path, const BookCounts &counts, std::uint32_t minCount)
+{
+    std::vector<std::pair<BookMove, std::uint32_t>> entries;
+    std::uint32_t top = 1;
+    for (const auto &e : counts) {
+        if (e.second>=minCount) {
+            entries.push_back(e);
+            top = std::max(top, e.second);
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+        return a.first.key!=b.first.key ? a.first.key < b.first.key : a.second > b.second;
+    });
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QByteArray out(qsizetype(entries.size()) * 16, '\0');
+    uchar *p = reinterpret_cast<uchar *>(out.data());
+    for (const auto &e : entries) {
+        // Weights are 16-bit; the most played move gets the full range
+        const auto weight = std::uint16_t(std::max<std::uint64_t>(1, std::uint64_t(e.second) * 65535 / top));
+        qToBigEndian<quint64>(e.first.key, p);
+        qToBigEndian<quint16>(e.first.move, p + 8);
+        qToBigEndian<quint16>(weight, p + 10);
+        qToBigEndian<quint32>(0, p + 12);
+        p += 16;
+    }
+    return file.write(out)==out.size();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Trace::Session traceSession;
+    QCoreApplication::setApplicationName("chessqt_pgn");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Checks every game of a PGN file by replaying it.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "PGN file to read.");
+    QCommandLineOption threadsOpt({"t", "threads"}, "Number of worker threads.", "n",
+                                  QString::number(std::max(1u, std::thread::hardware_concurrency())));
+    QCommandLineOption windowOpt("window", "Bytes of the file mapped at a time, in megabytes.", "mb", "64");
+    QCommandLineOption verboseOpt({"v", "verbose"}, "List every illegal game, not just the first 20.");
+    QCommandLineOption bookOpt("book", "Write an opening book of the games to <file>.", "file");
+    QCommandLineOption bookPliesOpt("book-plies", "Plies of each game that go into the book.", "n", "16");
+    QCommandLineOption bookMinOpt("book-min", "Leave out moves played fewer than <n> times.", "n", "2");
+    QCommandLineOption dbOpt("db", "Store the legal games in the SQLite database <file>.", "file");
+    parser.addOption(threadsOpt);
+    parser.addOption(windowOpt);
+    parser.addOption(verboseOpt);
+    parser.addOption(bookOpt);
+    parser.addOption(bookPliesOpt);
+    parser.addOption(bookMinOpt);
+    parser.addOption(dbOpt);
+    parser.process(app);
+
+    if (parser.positionalArguments().size()!=1)
+        parser.showHelp(2);
+    const int threads = std::max(1, parser.value(threadsOpt).toInt());
+    const bool verbose = parser.isSet(verboseOpt);
+    const bool makeBook = parser.isSet(bookOpt);
+    const int bookPlies = std::max(1, parser.value(bookPliesOpt).toInt());
+    const bool store = parser.isSet(dbOpt);
+    GameDatabase db;
+    if (store && !db.open(parser.value(dbOpt), "chessqt-import")) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(dbOpt)), qPrintable(db.lastError()));
+        return 2;
+    }
+
+    QFile file(parser.positionalArguments().first());
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(file.fileName()), qPrintable(file.errorString()));
+        return 2;
+    }
+    const qint64 fileSize = file.size();
+    qint64 window = std::max<qint64>(1, parser.value(windowOpt).toLongLong()) << 20;
+
+    // Only one window of the file is mapped at a time; a window ends at the
+    // last complete game and the next one starts there, so memory stays
+    // bounded however large the archive is.
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t games = 0, plies = 0, illegal = 0, rows = 0;
+    double storeSecs = 0;
+    BookCounts book;
+    std::vector<std::string_view> batch;
+    std::vector<Tally> tallies(threads);
+    qint64 offset = 0;
+    while (offset<fileSize) {
+        const qint64 length = std::min(window, fileSize - offset);
+        const bool atEnd = offset + length==fileSize;
+        uchar *data = file.map(offset, length);
+        if (!data) {
+            std::fprintf(stderr, "cannot map %s: %s\n", qPrintable(file.fileName()), qPrintable(file.errorString()));
+            return 2;
+        }
+        const std::string_view text(reinterpret_cast<const char *>(data), std::size_t(length));
+        batch.clear();
+        const std::size_t consumed = Pgn::splitGames(text, atEnd, batch);
+        if (consumed==0 && !atEnd) {
+            // A single game larger than the window
+            file.unmap(data);
+            window *= 2;
+            continue;
+        }
+
+        std::atomic<std::size_t> next{0};
+        auto work = [&](Tally &t) {
+            ChessBoard board;
+            std::vector<std::uint16_t> moves;
+            std::vector<std::uint64_t> keys;
+            for (std::size_t i = next++; i < batch.size(); i = next++) {
+                int ply = 0;
+                moves.clear();
+                keys.clear();
+                const Pgn::Replay r = Pgn::replay(batch[i], board, [&](const ChessBoard &b, Move m) {
+                    if (makeBook && ply<bookPlies)
+                        ++t.book[{OpeningBook::key(b), OpeningBook::encodeMove(m)}];
+                    if (store) {
+                        moves.push_back(m.raw());
+                        keys.push_back(b.key());
+                    }
+                    ++ply;
+                });
+                ++t.games;
+                t.plies += r.plies;
+                if (!r.error.empty())
+                    t.failures.push_back({games + i + 1, std::uint64_t(offset) + std::uint64_t(batch[i].data() - text.data()), r.error});
+                else if (store) {
+                    keys.push_back(board.key());
+                    t.imported.push_back({i, moves, keys});
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; ++i)
+            pool.emplace_back(work, std::ref(tallies[i]));
+        work(tallies[0]);
+        for (std::thread &th : pool)
+            th.join();
+
+        std::vector<Failure> failures;
+        std::vector<Imported> imported;
+        for (Tally &t : tallies) {
+            std::move(t.imported.begin(), t.imported.end(), std::back_inserter(imported));
+            games += t.games;
+            plies += t.plies;
+            failures.insert(failures.end(), t.failures.begin(), t.failures.end());
+            for (const auto &e : t.book)
+                book[e.first] += e.second;
+            t = Tally();
+        }
+        std::sort(failures.begin(), failures.end(), [](const Failure &a, const Failure &b) { return a.game < b.game; });
+        for (const Failure &f : failures) {
+            if (verbose || illegal<20)
+                std::printf("game %llu (byte %llu): %s\n", static_cast<unsigned long long>(f.game),
+                            static_cast<unsigned long long>(f.offset), f.message.c_str());
+            ++illegal;
+        }
+
+        if (store) {
+            const auto storeStart = std::chrono::steady_clock::now();
+            if (!storeGames(db, batch, imported, rows)) {
+                std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(dbOpt)), qPrintable(db.lastError()));
+                return 2;
+            }
+            storeSecs += elapsedSeconds(storeStart);
+        }
+
+        file.unmap(data);
+        offset += qint64(consumed);
+    }
+    const double secs = elapsedSeconds(start);
+
+    if (illegal>20 && !verbose)
+        std::printf("... %llu more, use -v to list all\n", static_cast<unsigned long long>(illegal - 20));
+    std::printf("Games: %llu\nIllegal: %llu\nPlies: %llu\nTime: %.3f s\nGames/s: %.0f\nMB/s: %.1f\n",
+                static_cast<unsigned long long>(games), static_cast<unsigned long long>(illegal),
+                static_cast<unsigned long long>(plies), secs, secs>0 ? games / secs : 0.0,
+                secs>0 ? fileSize / secs / (1 << 20) : 0.0);
+
+    if (store)
+        std::printf("Rows stored: %llu\nRows/s: %.0f\n", static_cast<unsigned long long>(rows),
+                    storeSecs>0 ? rows / storeSecs : 0.0);
+
+    if (makeBook) {
+        const auto minCount = std::uint32_t(std::max(1, parser.value(bookMinOpt).toInt()));
+        if (!writeBook(parser.value(bookOpt), book, minCount)) {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(bookOpt)));
+            return 2;
+        }
+        std::printf("Book: %s\n", qPrintable(parser.value(bookOpt)));
+    }
+    return illegal>0 ? 1 : 0;
+}
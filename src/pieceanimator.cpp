@@ -0,0 +1,70 @@
+#include "pieceanimator.h"
+#include "trace.h"
+
+namespace {
+
+constexpr int FrameMs = 16;
+// Drawn above resting pieces and the overlay markers below arrows
+constexpr qreal MovingZ = 1.5;
+
+// From one animation frame to the next, for checking frame pacing
+constinit const Trace::Point FrameInterval("animation frame interval");
+
+} // namespace
+
+PieceAnimator::PieceAnimator(QObject *parent)
+    : QObject(parent)
+{
+    m_frame.setTimerType(Qt::PreciseTimer);
+    m_frame.setInterval(FrameMs);
+    connect(&m_frame, &QTimer::timeout, this, &PieceAnimator::tick);
+}
+
+void PieceAnimator::slide(QGraphicsItem *item, const QPointF &from, const QPointF &to)
+{
+    if (m_slides.isEmpty())
+        m_clock.start();
+    m_slides.append({item, from, to, m_clock.elapsed(), item->zValue()});
+    item->setPos(from);
+    item->setZValue(MovingZ);
+    if (!m_frame.isActive()) {
+        m_frame.start();
+        m_lastFrame = Trace::start();
+    }
+}
+
+void PieceAnimator::finishAll()
+{
+    for (const Slide &s : m_slides) {
+        s.item->setPos(s.to);
+        s.item->setZValue(s.z);
+    }
+    m_slides.clear();
+    m_frame.stop();
+    m_lastFrame = 0;
+}
+
+void PieceAnimator::tick()
+{
+    Trace::complete(FrameInterval, m_lastFrame);
+    m_lastFrame = Trace::start();
+    const qint64 now = m_clock.elapsed();
+    for (int i = m_slides.size()-1; i >= 0; --i) {
+        const Slide &s = m_slides[i];
+        const qreal t = qMin<qreal>(1.0, qreal(now - s.start) / m_duration);
+        if (t>=1.0) {
+            s.item->setPos(s.to);
+            s.item->setZValue(s.z);
+            m_slides.removeAt(i);
+            continue;
+        }
+        // Ease out: fast start, gentle landing
+        const qreal u = 1.0 - t;
+        const qreal k = 1.0 - u*u*u;
+        s.item->setPos(s.from + (s.to - s.from)*k);
+    }
+    if (m_slides.isEmpty()) {
+        m_frame.stop();
+        m_lastFrame = 0;
+    }
+}
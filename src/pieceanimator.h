@@ -0,0 +1,47 @@
+#ifndef PIECEANIMATOR_H
+#define PIECEANIMATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QGraphicsItem>
+#include <QPointF>
+#include <QTimer>
+#include <QVector>
+
+// Slides pieces between squares. One frame timer drives every running slide
+// and positions come from elapsed time, so a late frame shortens nothing and
+// a missed one is simply skipped. The timer only runs while something moves.
+class PieceAnimator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PieceAnimator(QObject *parent = nullptr);
+
+    void setDuration(int ms) { m_duration = ms; }
+    // Moves item to 'from' at once and slides it back to 'to'
+    void slide(QGraphicsItem *item, const QPointF &from, const QPointF &to);
+    // Puts every moving item on its destination
+    void finishAll();
+    bool isRunning() const { return !m_slides.isEmpty(); }
+
+private slots:
+    void tick();
+
+private:
+    struct Slide
+    {
+        QGraphicsItem *item;
+        QPointF from;
+        QPointF to;
+        qint64 start;
+        qreal z;
+    };
+
+    QVector<Slide> m_slides;
+    QElapsedTimer m_clock;
+    QTimer m_frame;
+    int m_duration = 150;
+    qint64 m_lastFrame = 0; // Trace::start() of the previous frame
+};
+
+#endif // PIECEANIMATOR_H
@@ -0,0 +1,490 @@
+#include "search.h"
+#include "evaluate.h"
+#include "nnue.h"
+#include <algorithm>
+#include <array>
+#include <thread>
+
+using namespace Search;
+
+namespace {
+
+// Mate scores are stored relative to the node so they stay valid when the
+// same position is reached at a different distance from the root.
+int scoreToTT(int score, int ply)
+{
+    if (score >= MateBound) return score + ply;
+    if (score <= -MateBound) return score - ply;
+    return score;
+}
+
+int scoreFromTT(int score, int ply)
+{
+    if (score >= MateBound) return score - ply;
+    if (score <= -MateBound) return score + ply;
+    return score;
+}
+
+bool hasNonPawnMaterial(const ChessBoard &board, ChessBoard::Color c)
+{
+    Bitboard pawnsAndKing = c==ChessBoard::White
+        ? board.pieceMask(ChessBoard::WP) | board.pieceMask(ChessBoard::WK)
+        : board.pieceMask(ChessBoard::BP) | board.pieceMask(ChessBoard::BK);
+    return board.colorMask(c) & ~pawnsAndKing;
+}
+
+constexpr int TTMoveScore = 1 << 30;
+constexpr int CaptureScore = 1 << 28;
+constexpr int KillerScore = 1 << 27;
+
+// Moves one step of a selection sort so the best remaining move is at i
+Move pickMove(MoveList &moves, std::array<int, MoveList::Capacity> &scores, int i)
+{
+    int best = i;
+    for (int j = i+1; j < moves.size(); ++j)
+        if (scores[j] > scores[best])
+            best = j;
+    std::swap(moves[i], moves[best]);
+    std::swap(scores[i], scores[best]);
+    return moves[i];
+}
+
+} // namespace
+
+// One search thread. Everything mutated in the tree lives here so threads
+// only meet in the transposition table and the shared stop flag.
+class Searcher::Worker
+{
+public:
+    Worker(Searcher &owner, int id) : m_owner(owner), m_id(id) {}
+
+    void reset(const ChessBoard &board);
+    void run();
+
+    bool isMain() const { return m_id==0; }
+    std::uint64_t nodes() const { return m_nodes.load(std::memory_order_relaxed); }
+
+    int completedDepth = 0;
+    int score = 0;
+    std::vector<Move> pv;
+
+private:
+    int negamax(int alpha, int beta, int depth, int ply, bool pvNode);
+    int quiescence(int alpha, int beta, int ply);
+    void scoreMoves(const MoveList &moves, std::array<int, MoveList::Capacity> &scores,
+                    Move ttMove, int ply) const;
+    bool isCapture(Move m) const;
+    void updatePv(int ply, Move m);
+    void countNode();
+    void makeMove(Move m, ChessBoard::Undo &undo);
+    void unmakeMove(Move m, const ChessBoard::Undo &undo);
+    int evaluate() const;
+    bool stopped() const { return m_owner.m_stop.load(std::memory_order_relaxed); }
+
+    Searcher &m_owner;
+    const int m_id;
+    ChessBoard m_board;
+    Nnue::AccumulatorStack m_nnue;
+    bool m_useNnue = false;
+    int m_rootDepth = 0;
+    // Written only by this thread; relaxed so the main thread can sum it
+    std::atomic<std::uint64_t> m_nodes{0};
+
+    std::array<std::array<Move, 2>, MaxPly> m_killers{};
+    std::array<std::array<std::array<int, 64>, 64>, 2> m_history{};
+    std::array<std::array<Move, MaxPly>, MaxPly> m_pv{};
+    std::array<int, MaxPly> m_pvLength{};
+};
+
+Searcher::Searcher(TranspositionTable &tt)
+    : m_tt(tt)
+{
+    setThreads(1);
+}
+
+Searcher::~Searcher() = default;
+
+void Searcher::setThreads(int count)
+{
+    count = std::max(1, count);
+    m_workers.resize(count);
+    for (int i = 0; i < count; ++i)
+        if (!m_workers[i])
+            m_workers[i] = std::make_unique<Worker>(*this, i);
+}
+
+std::uint64_t Searcher::totalNodes() const
+{
+    std::uint64_t n = 0;
+    for (const auto &w : m_workers)
+        n += w->nodes();
+    return n;
+}
+
+SearchResult Searcher::collect(const Worker &worker) const
+{
+    SearchResult result;
+    result.score = worker.score;
+    result.depth = worker.completedDepth;
+    result.pv = worker.pv;
+    if (!result.pv.empty())
+        result.best = result.pv[0];
+    result.ponder = result.pv.size()>1 ? result.pv[1] : Move();
+    result.nodes = totalNodes();
+    result.time = m_time.elapsed();
+    return result;
+}
+
+SearchResult Searcher::search(const ChessBoard &board, const SearchLimits &limits)
+{
+    m_limits = limits;
+    m_stop.store(false, std::memory_order_relaxed);
+    m_time.start(limits, board.currentColor());
+    m_tt.newSearch();
+
+    SearchResult result;
+    MoveList rootMoves;
+    ChessBoard root = board;
+    root.legalMoves(rootMoves);
+    if (rootMoves.isEmpty())
+        return result;
+
+    for (auto &w : m_workers)
+        w->reset(board);
+    std::vector<std::thread> helpers;
+    for (std::size_t i = 1; i < m_workers.size(); ++i)
+        helpers.emplace_back([w = m_workers[i].get()] { w->run(); });
+    m_workers[0]->run();
+    stop();
+    for (std::thread &t : helpers)
+        t.join();
+
+    // A helper that finished a deeper iteration has the better line
+    const Worker *best = m_workers[0].get();
+    for (const auto &w : m_workers)
+        if (w->completedDepth > best->completedDepth && !w->pv.empty())
+            best = w.get();
+    result = collect(*best);
+    if (result.best.isNull())
+        result.best = rootMoves[0];
+
+    for (const auto &w : m_workers) {
+        ThreadStats stats;
+        stats.depth = w->completedDepth;
+        stats.nodes = w->nodes();
+        stats.nps = result.time>0 ? stats.nodes*1000/std::uint64_t(result.time) : 0;
+        result.threads.push_back(stats);
+    }
+    return result;
+}
+
+void Searcher::Worker::reset(const ChessBoard &board)
+{
+    m_board = board;
+    m_useNnue = m_owner.m_useNetwork && Nnue::isLoaded();
+    if (m_useNnue)
+        m_nnue.reset(board);
+    m_nodes.store(0, std::memory_order_relaxed);
+    m_rootDepth = 0;
+    completedDepth = 0;
+    score = 0;
+    pv.clear();
+    for (auto &k : m_killers)
+        k.fill(Move());
+    for (auto &side : m_history)
+        for (auto &from : side)
+            for (int &h : from)
+                h /= 2;
+}
+
+void Searcher::Worker::run()
+{
+    const SearchLimits &limits = m_owner.m_limits;
+    int maxDepth = limits.depth>0 ? std::min(limits.depth, MaxPly-1) : MaxPly-1;
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        // Odd helpers skip every other depth so threads spread over
+        // different iterations instead of repeating the same tree.
+        if (!isMain() && (m_id & 1) && depth>1 && (depth & 1))
+            continue;
+        m_rootDepth = depth;
+
+        // Aspiration window around the previous score, widened on failure
+        int delta = 25;
+        int alpha = -Infinite, beta = Infinite;
+        if (depth>=4) {
+            alpha = std::max(score - delta, -Infinite);
+            beta = std::min(score + delta, Infinite);
+        }
+        int value = 0;
+        for (;;) {
+            value = negamax(alpha, beta, depth, 0, true);
+            if (stopped())
+                break;
+            if (value<=alpha)
+                alpha = std::max(value - delta, -Infinite);
+            else if (value>=beta)
+                beta = std::min(value + delta, Infinite);
+            else
+                break;
+            delta *= 2;
+        }
+        if (stopped())
+            break;
+
+        score = value;
+        completedDepth = depth;
+        pv.assign(m_pv[0].begin(), m_pv[0].begin() + m_pvLength[0]);
+        if (isMain() && m_owner.onIteration)
+            m_owner.onIteration(m_owner.collect(*this));
+        // A forced mate found within the searched depth will not improve
+        if (std::abs(value)>=MateBound && MateScore-std::abs(value)<=depth)
+            break;
+        if (isMain() && m_owner.m_time.softLimitReached())
+            break;
+    }
+}
+
+// Only the main thread enforces limits; helpers just follow the stop flag
+void Searcher::Worker::countNode()
+{
+    std::uint64_t n = m_nodes.load(std::memory_order_relaxed) + 1;
+    m_nodes.store(n, std::memory_order_relaxed);
+    // The first iteration always completes so there is a move to play
+    if (!isMain() || (n & 1023) || m_rootDepth<=1)
+        return;
+    const SearchLimits &limits = m_owner.m_limits;
+    if (m_owner.m_time.hardLimitReached() || (limits.nodes && m_owner.totalNodes()>=limits.nodes))
+        m_owner.stop();
+}
+
+void Searcher::Worker::makeMove(Move m, ChessBoard::Undo &undo)
+{
+    m_board.makeMove(m, undo);
+    if (m_useNnue)
+        m_nnue.push(m_board, m, undo);
+}
+
+void Searcher::Worker::unmakeMove(Move m, const ChessBoard::Undo &undo)
+{
+    m_board.unmakeMove(m, undo);
+    if (m_useNnue)
+        m_nnue.pop();
+}
+
+// The network when one is loaded and enabled, else the hand-written
+// evaluation
+int Searcher::Worker::evaluate() const
+{
+    return m_useNnue ? m_nnue.evaluate(m_board.currentColor()) : Evaluation::evaluate(m_board);
+}
+
+bool Searcher::Worker::isCapture(Move m) const
+{
+    return m.kind()==Move::EnPassant || m_board.pieceAt(m.to())!=ChessBoard::Empty;
+}
+
+void Searcher::Worker::updatePv(int ply, Move m)
+{
+    m_pv[ply][ply] = m;
+    int len = ply+1<MaxPly ? m_pvLength[ply+1] : ply+1;
+    for (int i = ply+1; i < len; ++i)
+        m_pv[ply][i] = m_pv[ply+1][i];
+    m_pvLength[ply] = std::max(len, ply+1);
+}
+
+// TT move first, then captures by most valuable victim / least valuable
+// attacker, then killers, then quiet moves by history.
+void Searcher::Worker::scoreMoves(const MoveList &moves, std::array<int, MoveList::Capacity> &scores,
+                                  Move ttMove, int ply) const
+{
+    int us = m_board.currentColor();
+    for (int i = 0; i < moves.size(); ++i) {
+        Move m = moves[i];
+        if (m==ttMove) {
+            scores[i] = TTMoveScore;
+        } else if (isCapture(m) || m.kind()==Move::Promotion) {
+            int victim = m.kind()==Move::EnPassant ? Evaluation::PawnValue
+                                                   : Evaluation::pieceValue(m_board.pieceAt(m.to()));
+            if (m.kind()==Move::Promotion)
+                victim += m.promotion()==Move::Queen ? Evaluation::QueenValue : 0;
+            scores[i] = CaptureScore + victim*16 - Evaluation::pieceValue(m_board.pieceAt(m.from()))/16;
+        } else if (m==m_killers[ply][0] || m==m_killers[ply][1]) {
+            scores[i] = KillerScore;
+        } else {
+            scores[i] = m_history[us][m.from()][m.to()];
+        }
+    }
+}
+
+int Searcher::Worker::negamax(int alpha, int beta, int depth, int ply, bool pvNode)
+{
+    m_pvLength[ply] = ply;
+    if (ply>0) {
+        if (m_board.halfmoveClock()>=100 || m_board.repetitions()>=1)
+            return 0;
+        // Mate distance pruning
+        alpha = std::max(alpha, -MateScore + ply);
+        beta = std::min(beta, MateScore - ply - 1);
+        if (alpha>=beta)
+            return alpha;
+    }
+
+    ChessBoard::Color us = m_board.currentColor();
+    bool inCheck = m_board.isInCheck(us);
+    if (inCheck)
+        ++depth;
+    if (depth<=0)
+        return quiescence(alpha, beta, ply);
+    if (ply>=MaxPly-1)
+        return evaluate();
+
+    countNode();
+    if (stopped())
+        return 0;
+
+    const std::uint64_t key = m_board.key();
+    TranspositionTable::Entry tte;
+    Move ttMove;
+    if (m_owner.m_tt.probe(key, tte)) {
+        ttMove = Move::fromRaw(tte.move);
+        int ttScore = scoreFromTT(tte.score, ply);
+        if (!pvNode && tte.depth>=depth) {
+            if (tte.bound==TranspositionTable::BoundExact
+                || (tte.bound==TranspositionTable::BoundLower && ttScore>=beta)
+                || (tte.bound==TranspositionTable::BoundUpper && ttScore<=alpha))
+                return ttScore;
+        }
+    }
+
+    int staticEval = inCheck ? -Infinite : evaluate();
+    if (!pvNode && !inCheck) {
+        // Reverse futility: far above beta at low depth
+        if (depth<=3 && staticEval - 120*depth >= beta)
+            return staticEval;
+        // Null move: passing still fails high, so a real move will too
+        if (depth>=3 && staticEval>=beta && hasNonPawnMaterial(m_board, us)) {
+            ChessBoard::Undo undo;
+            m_board.makeNullMove(undo);
+            int score = -negamax(-beta, -beta+1, depth-1-(2 + depth/6), ply+1, false);
+            m_board.unmakeNullMove(undo);
+            if (stopped())
+                return 0;
+            if (score>=beta)
+                return score>=MateBound ? beta : score;
+        }
+    }
+
+    MoveList moves;
+    m_board.legalMoves(moves);
+    if (moves.isEmpty())
+        return inCheck ? -MateScore + ply : 0;
+    std::array<int, MoveList::Capacity> scores;
+    scoreMoves(moves, scores, ttMove, ply);
+
+    const int origAlpha = alpha;
+    int best = -Infinite;
+    Move bestMove;
+    for (int i = 0; i < moves.size(); ++i) {
+        Move m = pickMove(moves, scores, i);
+        bool quiet = !isCapture(m) && m.kind()!=Move::Promotion;
+
+        ChessBoard::Undo undo;
+        makeMove(m, undo);
+        int score;
+        if (i==0) {
+            score = -negamax(-beta, -alpha, depth-1, ply+1, pvNode);
+        } else {
+            // Late move reductions for quiet moves ordered far down the list
+            int reduction = 0;
+            if (depth>=3 && i>=3 && quiet && !inCheck)
+                reduction = std::min(depth-2, 1 + (i>=8) + (depth>=8));
+            score = -negamax(-alpha-1, -alpha, depth-1-reduction, ply+1, false);
+            if (score>alpha && reduction)
+                score = -negamax(-alpha-1, -alpha, depth-1, ply+1, false);
+            if (score>alpha && score<beta && pvNode)
+                score = -negamax(-beta, -alpha, depth-1, ply+1, true);
+        }
+        unmakeMove(m, undo);
+        if (stopped())
+            return 0;
+
+        if (score>best) {
+            best = score;
+            bestMove = m;
+            if (score>alpha) {
+                alpha = score;
+                updatePv(ply, m);
+                if (alpha>=beta) {
+                    if (quiet) {
+                        if (m_killers[ply][0]!=m) {
+                            m_killers[ply][1] = m_killers[ply][0];
+                            m_killers[ply][0] = m;
+                        }
+                        int &h = m_history[us][m.from()][m.to()];
+                        h = std::min(h + depth*depth, KillerScore-1);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    TranspositionTable::Entry entry;
+    entry.move = bestMove.raw();
+    entry.score = static_cast<std::int16_t>(scoreToTT(best, ply));
+    entry.eval = static_cast<std::int16_t>(inCheck ? 0 : staticEval);
+    entry.depth = static_cast<std::uint8_t>(depth);
+    entry.bound = best>=beta ? TranspositionTable::BoundLower
+                : best>origAlpha ? TranspositionTable::BoundExact : TranspositionTable::BoundUpper;
+    m_owner.m_tt.store(key, entry);
+    return best;
+}
+
+int Searcher::Worker::quiescence(int alpha, int beta, int ply)
+{
+    m_pvLength[ply] = ply;
+    countNode();
+    if (stopped())
+        return 0;
+    if (ply>=MaxPly-1)
+        return evaluate();
+
+    bool inCheck = m_board.isInCheck(m_board.currentColor());
+    int best = -Infinite;
+    if (!inCheck) {
+        best = evaluate();
+        if (best>=beta)
+            return best;
+        alpha = std::max(alpha, best);
+    }
+
+    MoveList moves;
+    m_board.legalMoves(moves);
+    if (moves.isEmpty())
+        return inCheck ? -MateScore + ply : 0;
+    std::array<int, MoveList::Capacity> scores;
+    scoreMoves(moves, scores, Move(), ply);
+
+    for (int i = 0; i < moves.size(); ++i) {
+        Move m = pickMove(moves, scores, i);
+        // Outside check only captures and queen promotions are resolved
+        if (!inCheck && !isCapture(m) && !(m.kind()==Move::Promotion && m.promotion()==Move::Queen))
+            continue;
+        ChessBoard::Undo undo;
+        makeMove(m, undo);
+        int score = -quiescence(-beta, -alpha, ply+1);
+        unmakeMove(m, undo);
+        if (stopped())
+            return 0;
+        if (score>best) {
+            best = score;
+            if (score>alpha) {
+                alpha = score;
+                updatePv(ply, m);
+                if (alpha>=beta)
+                    break;
+            }
+        }
+    }
+    return best;
+}
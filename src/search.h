@@ -0,0 +1,81 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "chessboard.h"
+#include "timemanager.h"
+#include "transposition.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Search {
+
+constexpr int MaxPly = 64;
+constexpr int Infinite = 32001;
+constexpr int MateScore = 32000;
+// Scores beyond this bound encode a forced mate
+constexpr int MateBound = MateScore - MaxPly;
+
+} // namespace Search
+
+struct ThreadStats
+{
+    int depth = 0;          // deepest completed iteration
+    std::uint64_t nodes = 0;
+    std::uint64_t nps = 0;
+};
+
+struct SearchResult
+{
+    Move best;
+    Move ponder;
+    int score = 0;
+    int depth = 0;
+    std::uint64_t nodes = 0;    // summed over all threads
+    std::int64_t time = 0;
+    std::vector<Move> pv;
+    std::vector<ThreadStats> threads;
+};
+
+// Iterative-deepening principal variation search on private copies of the
+// board. With more than one thread it runs Lazy SMP: helpers search the same
+// root independently and share results only through the transposition
+// table. search() blocks the calling thread, which acts as the main search
+// thread; stop() may be called from any other thread and makes search()
+// return the last completed iteration.
+class Searcher
+{
+public:
+    explicit Searcher(TranspositionTable &tt);
+    ~Searcher();
+
+    void setThreads(int count);
+    int threads() const { return int(m_workers.size()); }
+    // Evaluate with the loaded Nnue network, when there is one, instead of
+    // Evaluation. On by default.
+    void setUseNetwork(bool use) { m_useNetwork = use; }
+
+    SearchResult search(const ChessBoard &board, const SearchLimits &limits);
+    void stop() { m_stop.store(true, std::memory_order_relaxed); }
+
+    // Invoked on the searching thread after every completed main iteration
+    std::function<void(const SearchResult &)> onIteration;
+
+private:
+    class Worker;
+    friend class Worker;
+
+    std::uint64_t totalNodes() const;
+    SearchResult collect(const Worker &worker) const;
+
+    TranspositionTable &m_tt;
+    TimeManager m_time;
+    SearchLimits m_limits;
+    std::atomic<bool> m_stop{false};
+    bool m_useNetwork = true;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+};
+
+#endif // SEARCH_H
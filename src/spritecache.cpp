@@ -0,0 +1,77 @@
+#include "spritecache.h"
+#include <QHash>
+#include <QImage>
+#include <array>
+
+namespace {
+
+QHash<quint64, QPixmap> &cache()
+{
+    static QHash<quint64, QPixmap> sprites;
+    return sprites;
+}
+
+// Source images by piece, decoded on first use
+std::array<QImage, 13> &sources()
+{
+    static std::array<QImage, 13> images;
+    return images;
+}
+
+quint64 key(ChessBoard::Piece p, int size, qreal dpr)
+{
+    return quint64(p) | quint64(size) << 8 | quint64(qRound(dpr * 100)) << 32;
+}
+
+} // namespace
+
+QString SpriteCache::pieceName(ChessBoard::Piece p)
+{
+    switch (p) {
+    case ChessBoard::WP: return "pawn_w";
+    case ChessBoard::WR: return "rook_w";
+    case ChessBoard::WN: return "knight_w";
+    case ChessBoard::WB: return "bishop_w";
+    case ChessBoard::WQ: return "queen_w";
+    case ChessBoard::WK: return "king_w";
+    case ChessBoard::BP: return "pawn_b";
+    case ChessBoard::BR: return "rook_b";
+    case ChessBoard::BN: return "knight_b";
+    case ChessBoard::BB: return "bishop_b";
+    case ChessBoard::BQ: return "queen_b";
+    case ChessBoard::BK: return "king_b";
+    default: return QString();
+    }
+}
+
+QPixmap SpriteCache::piece(ChessBoard::Piece p, int size, qreal dpr)
+{
+    if (p==ChessBoard::Empty)
+        return QPixmap();
+    const quint64 k = key(p, size, dpr);
+    auto it = cache().constFind(k);
+    if (it!=cache().constEnd())
+        return *it;
+
+    QImage &source = sources()[p];
+    if (source.isNull()) {
+        const QString name = pieceName(p);
+        source.load(":/images/" + name + ".png");
+        if (source.isNull())
+            source.load("../assets/" + name + ".png");
+    }
+    QPixmap pix;
+    if (!source.isNull()) {
+        const int pixels = qRound(size * dpr);
+        pix = QPixmap::fromImage(source.scaled(pixels, pixels, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        pix.setDevicePixelRatio(dpr);
+    }
+    cache().insert(k, pix);
+    return pix;
+}
+
+void SpriteCache::clear()
+{
+    cache().clear();
+    sources().fill(QImage());
+}
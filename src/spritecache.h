@@ -0,0 +1,19 @@
+#ifndef SPRITECACHE_H
+#define SPRITECACHE_H
+
+#include <QPixmap>
+#include <QString>
+#include "chessboard.h"
+
+// Piece images decoded once and kept per (piece, size, device pixel ratio),
+// so redraws and resizes reuse ready-scaled pixmaps.
+class SpriteCache
+{
+public:
+    // size is in device-independent pixels; the pixmap carries dpr
+    static QPixmap piece(ChessBoard::Piece p, int size, qreal dpr);
+    static QString pieceName(ChessBoard::Piece p);
+    static void clear();
+};
+
+#endif // SPRITECACHE_H
@@ -0,0 +1,50 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QDir>
+#include <cstdio>
+
+// Build step shrinking the piece artwork to the resolution the board can
+// actually use, so the application does not embed and decode 1024px PNGs.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes size-optimized piece sprites");
+    parser.addHelpOption();
+    QCommandLineOption sizeOpt({"s", "size"}, "Largest edge in pixels.", "px", "128");
+    QCommandLineOption outOpt({"o", "output"}, "Output directory.", "dir", ".");
+    parser.addOption(sizeOpt);
+    parser.addOption(outOpt);
+    parser.addPositionalArgument("images", "Source PNG files.");
+    parser.process(app);
+
+    const int size = parser.value(sizeOpt).toInt();
+    const QDir out(parser.value(outOpt));
+    if (size<=0 || parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+    out.mkpath(".");
+
+    for (const QString &path : parser.positionalArguments()) {
+        QImage image(path);
+        if (image.isNull()) {
+            std::fprintf(stderr, "cannot read %s\n", qPrintable(path));
+            return 1;
+        }
+        if (image.width()>size || image.height()>size)
+            image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+
+        const QString target = out.filePath(QFileInfo(path).fileName());
+        QImageWriter writer(target, "png");
+        // For PNG a lower quality means a higher zlib level; pixels are unchanged
+        writer.setQuality(0);
+        if (!writer.write(image)) {
+            std::fprintf(stderr, "cannot write %s: %s\n", qPrintable(target), qPrintable(writer.errorString()));
+            return 1;
+        }
+    }
+    return 0;
+}
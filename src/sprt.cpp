@@ -0,0 +1,70 @@
+#include "sprt.h"
+#include <algorithm>
+#include <cmath>
+
+double MatchScore::score() const
+{
+    return games()>0 ? (wins + 0.5 * draws) / games() : 0.5;
+}
+
+double MatchScore::variance() const
+{
+    if (games()==0)
+        return 0;
+    const double s = score();
+    return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+}
+
+double MatchScore::eloToScore(double elo)
+{
+    return 1 / (1 + std::pow(10.0, -elo / 400));
+}
+
+double MatchScore::scoreToElo(double score)
+{
+    // A clean sweep has no finite Elo; report the edge of what is shown
+    score = std::clamp(score, 1e-6, 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+double MatchScore::elo() const
+{
+    return scoreToElo(score());
+}
+
+double MatchScore::eloMargin() const
+{
+    if (games()==0)
+        return 0;
+    const double s = score();
+    const double error = 1.959964 * std::sqrt(variance() / games());
+    return (scoreToElo(s + error) - scoreToElo(s - error)) / 2;
+}
+
+Sprt::Sprt(double elo0, double elo1, double alpha, double beta)
+    : m_score0(MatchScore::eloToScore(elo0)),
+      m_score1(MatchScore::eloToScore(elo1)),
+      m_lower(std::log(beta / (1 - alpha))),
+      m_upper(std::log((1 - beta) / alpha))
+{
+}
+
+double Sprt::llr(const MatchScore &score) const
+{
+    const double variance = score.variance();
+    // Until both wins and losses (or draws) appear there is no spread to
+    // measure against
+    if (variance<=0)
+        return 0;
+    return score.games() * (m_score1 - m_score0) * (2 * score.score() - m_score0 - m_score1) / (2 * variance);
+}
+
+Sprt::Decision Sprt::decide(const MatchScore &score) const
+{
+    const double ratio = llr(score);
+    if (ratio>=m_upper)
+        return AcceptH1;
+    if (ratio<=m_lower)
+        return AcceptH0;
+    return Continue;
+}
@@ -0,0 +1,48 @@
+#ifndef SPRT_H
+#define SPRT_H
+
+// Wins, draws and losses of one side of a match, with the Elo difference
+// they imply on the logistic scale
+struct MatchScore
+{
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    // Points per game, 0..1
+    double score() const;
+    // Variance of the points of a single game
+    double variance() const;
+    double elo() const;
+    // Half width of the 95% confidence interval of elo()
+    double eloMargin() const;
+
+    static double eloToScore(double elo);
+    static double scoreToElo(double score);
+};
+
+// Sequential probability ratio test of H0: elo = elo0 against
+// H1: elo = elo1. The log-likelihood ratio uses the normal approximation
+// of the generalized SPRT on the trinomial results, so it can be updated
+// after every game at no cost.
+class Sprt
+{
+public:
+    enum Decision { Continue, AcceptH0, AcceptH1 };
+
+    Sprt(double elo0, double elo1, double alpha, double beta);
+
+    double llr(const MatchScore &score) const;
+    double lowerBound() const { return m_lower; }
+    double upperBound() const { return m_upper; }
+    Decision decide(const MatchScore &score) const;
+
+private:
+    double m_score0;
+    double m_score1;
+    double m_lower;
+    double m_upper;
+};
+
+#endif // SPRT_H
@@ -0,0 +1,785 @@
+#include "syzygy.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace Syzygy {
+
+namespace {
+
+// The tables count squares from a1 upwards (a1=0, h8=63) and number the
+// pieces P=1 N=2 B=3 R=4 Q=5 K=6, black ones 8 higher.
+int tbSquare(int sq) { return sq ^ 56; }
+int fileOf(int s) { return s & 7; }
+int rankOf(int s) { return s >> 3; }
+int offA1H8(int s) { return rankOf(s) - fileOf(s); }
+
+int tbPiece(ChessBoard::Piece p)
+{
+    static constexpr int codes[] = {0, 1, 4, 2, 3, 5, 6, 9, 12, 10, 11, 13, 14};
+    return codes[p];
+}
+
+enum Flag { Stm = 1, Mapped = 2, WinPlies = 4, LossPlies = 8, Wide = 16, SingleValue = 128 };
+
+std::uint16_t readLE16(const std::uint8_t *p) { return std::uint16_t(p[0] | p[1] << 8); }
+
+std::uint32_t readLE32(const std::uint8_t *p)
+{
+    return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+}
+
+std::uint32_t readBE32(const std::uint8_t *p)
+{
+    return std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | std::uint32_t(p[3]);
+}
+
+std::uint64_t readBE64(const std::uint8_t *p)
+{
+    return std::uint64_t(readBE32(p)) << 32 | readBE32(p + 4);
+}
+
+// Squares and binomials of the index encoding, as the generator defines it
+struct Encoding
+{
+    std::array<int, 64> mapPawns{};  // a2..h7 to 0..47, edge files and low ranks last
+    std::array<int, 64> mapB1H1H7{}; // below the a1-h8 diagonal to 0..27
+    std::array<int, 64> mapA1D1D4{}; // the a1-d1-d4 triangle to 0..9
+    std::array<std::array<int, 64>, 10> mapKK{}; // the 462 king pairs
+    std::array<std::array<int, 64>, MaxPieces> binomial{}; // [k][n]: n choose k
+    std::array<std::array<int, 64>, 6> leadPawnIdx{};
+    std::array<std::array<int, 4>, 6> leadPawnsSize{};
+
+    Encoding()
+    {
+        int code = 0;
+        for (int s = 0; s < 64; ++s)
+            if (offA1H8(s) < 0)
+                mapB1H1H7[s] = code++;
+
+        std::vector<int> diagonal;
+        code = 0;
+        for (int s = 0; s <= 27; ++s) {
+            if (offA1H8(s) < 0 && fileOf(s) <= 3)
+                mapA1D1D4[s] = code++;
+            else if (!offA1H8(s) && fileOf(s) <= 3)
+                diagonal.push_back(s);
+        }
+        for (int s : diagonal)
+            mapA1D1D4[s] = code++;
+
+        // The first king is in the triangle; when it stands on the diagonal
+        // the second is not above it. Both on the diagonal come last.
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; ++idx)
+            for (int s1 = 0; s1 <= 27; ++s1) {
+                if (mapA1D1D4[s1]!=idx || (idx==0 && s1!=1))
+                    continue;
+                for (int s2 = 0; s2 < 64; ++s2) {
+                    if (std::abs(fileOf(s1) - fileOf(s2)) <= 1 && std::abs(rankOf(s1) - rankOf(s2)) <= 1)
+                        continue;
+                    if (!offA1H8(s1) && offA1H8(s2) > 0)
+                        continue;
+                    if (!offA1H8(s1) && !offA1H8(s2))
+                        bothOnDiagonal.emplace_back(idx, s2);
+                    else
+                        mapKK[idx][s2] = code++;
+                }
+            }
+        for (const auto &[idx, s2] : bothOnDiagonal)
+            mapKK[idx][s2] = code++;
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; ++n)
+            for (int k = 0; k < MaxPieces && k <= n; ++k)
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+        int available = 47;
+        for (int leadPawns = 1; leadPawns <= 5; ++leadPawns)
+            for (int f = 0; f < 4; ++f) {
+                int idx = 0;
+                for (int r = 1; r <= 6; ++r) {
+                    const int sq = r*8 + f;
+                    if (leadPawns==1) {
+                        mapPawns[sq] = available--;
+                        mapPawns[sq ^ 7] = available--;
+                    }
+                    leadPawnIdx[leadPawns][sq] = idx;
+                    idx += binomial[leadPawns - 1][mapPawns[sq]];
+                }
+                leadPawnsSize[leadPawns][f] = idx;
+            }
+    }
+};
+
+const Encoding &encoding()
+{
+    static const Encoding e;
+    return e;
+}
+
+std::string sidePieces(const ChessBoard &board, ChessBoard::Color c)
+{
+    static const char letters[] = "KQRBNP";
+    static const ChessBoard::Piece white[] = {ChessBoard::WK, ChessBoard::WQ, ChessBoard::WR,
+                                              ChessBoard::WB, ChessBoard::WN, ChessBoard::WP};
+    static const ChessBoard::Piece black[] = {ChessBoard::BK, ChessBoard::BQ, ChessBoard::BR,
+                                              ChessBoard::BB, ChessBoard::BN, ChessBoard::BP};
+    std::string s;
+    for (int i = 0; i < 6; ++i) {
+        const ChessBoard::Piece p = c==ChessBoard::White ? white[i] : black[i];
+        s.append(Bitboards::popCount(board.pieceMask(p)), letters[i]);
+    }
+    return s;
+}
+
+// Tables are named with the side that has more material first
+bool stronger(const std::string &a, const std::string &b)
+{
+    if (a.size()!=b.size())
+        return a.size() > b.size();
+    static const std::string order = "KQRBNP";
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (a[i]!=b[i])
+            return order.find(a[i]) < order.find(b[i]);
+    return true;
+}
+
+int pieceCount(const ChessBoard &board)
+{
+    return Bitboards::popCount(board.colorMask(ChessBoard::White) | board.colorMask(ChessBoard::Black));
+}
+
+bool isCapture(const ChessBoard &board, Move m)
+{
+    return board.pieceAt(m.to())!=ChessBoard::Empty || m.kind()==Move::EnPassant;
+}
+
+bool isPawn(ChessBoard::Piece p)
+{
+    return p==ChessBoard::WP || p==ChessBoard::BP;
+}
+
+// Root moves are ranked in bands this far apart, wider than any DTZ
+constexpr int MaxDtz = 1 << 18;
+
+int signOf(int v)
+{
+    return (0 < v) - (v < 0);
+}
+
+// DTZ of the move before a capture or pawn move, which the DTZ tables do
+// not store, from the result it leads to
+int dtzBeforeZeroing(Wdl wdl)
+{
+    switch (wdl) {
+    case Win: return 1;
+    case CursedWin: return 101;
+    case BlessedLoss: return -101;
+    case Loss: return -1;
+    default: return 0;
+    }
+}
+
+// Symbols of the recursive pairing: 12-bit left and right children
+int leftSymbol(const std::uint8_t *btree, int sym)
+{
+    const std::uint8_t *lr = btree + 3*sym;
+    return (lr[1] & 0xF) << 8 | lr[0];
+}
+
+int rightSymbol(const std::uint8_t *btree, int sym)
+{
+    const std::uint8_t *lr = btree + 3*sym;
+    return lr[2] << 4 | lr[1] >> 4;
+}
+
+// Number of values a symbol expands to, minus one
+std::uint8_t symbolLength(Table::Pairs &d, int sym, std::vector<bool> &visited)
+{
+    visited[sym] = true;
+    const int right = rightSymbol(d.btree, sym);
+    if (right==0xFFF)
+        return 0;
+    const int left = leftSymbol(d.btree, sym);
+    if (left >= int(d.symlen.size()) || right >= int(d.symlen.size()))
+        return 0;
+    if (!visited[left])
+        d.symlen[left] = symbolLength(d, left, visited);
+    if (!visited[right])
+        d.symlen[right] = symbolLength(d, right, visited);
+    return std::uint8_t(d.symlen[left] + d.symlen[right] + 1);
+}
+
+// Value number idx of the table: the block holding it is found through the
+// sparse index, then the block's canonical Huffman symbols are skipped until
+// the one covering idx, which is expanded down to a single value
+int decompress(const Table::Pairs &d, std::uint64_t idx)
+{
+    if (d.flags & SingleValue)
+        return d.minSymLen;
+
+    const std::size_t k = idx / d.span;
+    std::uint32_t block = readLE32(d.sparseIndex + 6*k);
+    std::int64_t offset = readLE16(d.sparseIndex + 6*k + 4);
+    offset += std::int64_t(idx % d.span) - std::int64_t(d.span / 2);
+
+    while (offset < 0)
+        offset += readLE16(d.blockLength + 2*(--block)) + 1;
+    while (offset > readLE16(d.blockLength + 2*block))
+        offset -= readLE16(d.blockLength + 2*(block++)) + 1;
+
+    const std::uint8_t *ptr = d.data + std::uint64_t(block) * d.blockSize;
+    std::uint64_t buf64 = readBE64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+    for (;;) {
+        int len = 0;
+        while (buf64 < d.base64[len])
+            ++len;
+        sym = int((buf64 - d.base64[len]) >> (64 - len - d.minSymLen));
+        sym += readLE16(d.lowestSym + 2*len);
+        if (offset < d.symlen[sym] + 1)
+            break;
+        offset -= d.symlen[sym] + 1;
+        len += d.minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32) {
+            buf64Size += 32;
+            buf64 |= std::uint64_t(readBE32(ptr)) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    while (d.symlen[sym]) {
+        const int left = leftSymbol(d.btree, sym);
+        if (offset < d.symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d.symlen[left] + 1;
+            sym = rightSymbol(d.btree, sym);
+        }
+    }
+    return leftSymbol(d.btree, sym);
+}
+
+} // namespace
+
+std::string materialName(const ChessBoard &board)
+{
+    const std::string white = sidePieces(board, ChessBoard::White);
+    const std::string black = sidePieces(board, ChessBoard::Black);
+    return stronger(white, black) ? white + "v" + black : black + "v" + white;
+}
+
+bool Table::init(Type type, const std::string &name, const std::uint8_t *data, std::size_t size)
+{
+    static constexpr std::uint8_t magic[2][4] = {{0x71, 0xE8, 0x23, 0x5D}, {0xD7, 0x66, 0x0C, 0xA5}};
+    if (size < 16 || size%64!=16 || std::memcmp(data, magic[type], 4)!=0)
+        return false;
+
+    const std::size_t v = name.find('v');
+    if (v==std::string::npos)
+        return false;
+    const std::string white = name.substr(0, v);
+    const std::string black = name.substr(v + 1);
+    m_type = type;
+    m_key = name;
+    m_key2 = black + "v" + white;
+    m_pieceCount = int(white.size() + black.size());
+    if (m_pieceCount < 3 || m_pieceCount > MaxPieces)
+        return false;
+    m_hasPawns = name.find('P')!=std::string::npos;
+    m_hasUniquePieces = false;
+    for (const std::string *side : {&white, &black})
+        for (char c : std::string("QRBNP"))
+            if (std::count(side->begin(), side->end(), c)==1)
+                m_hasUniquePieces = true;
+
+    // The side with fewer pawns leads, which compresses better
+    const int whitePawns = int(std::count(white.begin(), white.end(), 'P'));
+    const int blackPawns = int(std::count(black.begin(), black.end(), 'P'));
+    const bool whiteLeads = !blackPawns || (whitePawns && blackPawns >= whitePawns);
+    m_pawnCount = whiteLeads ? std::array<int, 2>{whitePawns, blackPawns} : std::array<int, 2>{blackPawns, whitePawns};
+
+    const std::uint8_t *const base = data;
+    const std::uint8_t *const end = data + size;
+    data += 4;
+    enum { Split = 1, HasPawns = 2 };
+    if (bool(*data & HasPawns)!=m_hasPawns || bool(*data & Split)!=(m_key!=m_key2))
+        return false;
+    ++data;
+
+    m_sides = type==WdlTable && m_key!=m_key2 ? 2 : 1;
+    const int maxFile = m_hasPawns ? 3 : 0;
+    const bool pp = m_hasPawns && m_pawnCount[1]; // pawns on both sides
+
+    for (int f = 0; f <= maxFile; ++f) {
+        for (int i = 0; i < m_sides; ++i)
+            pairs(i, f) = Pairs();
+        const int order[2][2] = {{data[0] & 0xF, pp ? data[1] & 0xF : 0xF},
+                                 {data[0] >> 4, pp ? data[1] >> 4 : 0xF}};
+        data += 1 + pp;
+        for (int k = 0; k < m_pieceCount; ++k, ++data)
+            for (int i = 0; i < m_sides; ++i)
+                pairs(i, f).pieces[k] = i ? *data >> 4 : *data & 0xF;
+        for (int i = 0; i < m_sides; ++i)
+            setGroups(pairs(i, f), order[i], f);
+    }
+    data += (data - base) & 1;
+
+    for (int f = 0; f <= maxFile; ++f)
+        for (int i = 0; i < m_sides; ++i) {
+            data = setSizes(pairs(i, f), data);
+            if (!data || data > end)
+                return false;
+        }
+
+    if (type==DtzTable) {
+        m_map = data;
+        for (int f = 0; f <= maxFile; ++f) {
+            Pairs &d = pairs(0, f);
+            if (!(d.flags & Mapped))
+                continue;
+            if (d.flags & Wide) {
+                data += (data - base) & 1;
+                for (int i = 0; i < 4; ++i) {
+                    d.mapIdx[i] = std::uint32_t(data - m_map + 2);
+                    data += 2*readLE16(data) + 2;
+                }
+            } else {
+                for (int i = 0; i < 4; ++i) {
+                    d.mapIdx[i] = std::uint32_t(data - m_map + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+        data += (data - base) & 1;
+    }
+
+    for (int f = 0; f <= maxFile; ++f)
+        for (int i = 0; i < m_sides; ++i) {
+            Pairs &d = pairs(i, f);
+            d.sparseIndex = data;
+            data += d.sparseIndexSize * 6;
+        }
+    for (int f = 0; f <= maxFile; ++f)
+        for (int i = 0; i < m_sides; ++i) {
+            Pairs &d = pairs(i, f);
+            d.blockLength = data;
+            data += d.blockLengthSize * 2;
+        }
+    for (int f = 0; f <= maxFile; ++f)
+        for (int i = 0; i < m_sides; ++i) {
+            Pairs &d = pairs(i, f);
+            data += (64 - (data - base)%64) % 64;
+            d.data = data;
+            data += std::uint64_t(d.numBlocks) * d.blockSize;
+        }
+    return data <= end;
+}
+
+// Pieces of one colour and type form a group, except the leading group:
+// the pawns of the leading colour, else three unique pieces, else the kings.
+// The groups are encoded in the table's own order, as
+// g1 * N(g2) * N(g3) + g2 * N(g3) + g3 for N(g) placements of group g.
+void Table::setGroups(Pairs &d, const int order[2], int file)
+{
+    const Encoding &e = encoding();
+    int n = 0;
+    int firstLen = m_hasPawns ? 0 : m_hasUniquePieces ? 3 : 2;
+    d.groupLen[n] = 1;
+    for (int i = 1; i < m_pieceCount; ++i) {
+        if (--firstLen > 0 || d.pieces[i]==d.pieces[i - 1])
+            d.groupLen[n]++;
+        else
+            d.groupLen[++n] = 1;
+    }
+    d.groupLen[++n] = 0;
+
+    const bool pp = m_hasPawns && m_pawnCount[1];
+    int next = pp ? 2 : 1;
+    int freeSquares = 64 - d.groupLen[0] - (pp ? d.groupLen[1] : 0);
+    std::uint64_t idx = 1;
+    for (int k = 0; next < n || k==order[0] || k==order[1]; ++k) {
+        if (k==order[0]) {
+            d.groupIdx[0] = idx;
+            idx *= m_hasPawns ? e.leadPawnsSize[std::min(d.groupLen[0], 5)][file]
+                 : m_hasUniquePieces ? 31332 : 462;
+        } else if (k==order[1]) {
+            d.groupIdx[1] = idx;
+            idx *= e.binomial[std::min(d.groupLen[1], MaxPieces - 1)][48 - d.groupLen[0]];
+        } else {
+            d.groupIdx[next] = idx;
+            idx *= e.binomial[std::min(d.groupLen[next], MaxPieces - 1)][std::max(freeSquares, 0)];
+            freeSquares -= d.groupLen[next++];
+        }
+    }
+    d.groupIdx[n] = idx;
+}
+
+const std::uint8_t *Table::setSizes(Pairs &d, const std::uint8_t *data)
+{
+    d.flags = *data++;
+    if (d.flags & SingleValue) {
+        d.minSymLen = *data++; // the value every position has
+        return data;
+    }
+
+    const std::size_t groups = std::find(d.groupLen.begin(), d.groupLen.end(), 0) - d.groupLen.begin();
+    const std::uint64_t tbSize = d.groupIdx[groups];
+
+    d.blockSize = std::size_t(1) << *data++;
+    d.span = std::size_t(1) << *data++;
+    d.sparseIndexSize = std::size_t((tbSize + d.span - 1) / d.span);
+    const int padding = *data++;
+    d.numBlocks = readLE32(data);
+    data += 4;
+    d.blockLengthSize = d.numBlocks + padding; // keeps the sparse index in range
+    d.maxSymLen = *data++;
+    d.minSymLen = *data++;
+    if (d.minSymLen==0 || d.maxSymLen < d.minSymLen)
+        return nullptr;
+    d.lowestSym = data;
+
+    // Canonical Huffman code: longer symbols have lower values, so the
+    // lowest symbol of each length, left aligned in 64 bits, tells the
+    // length of the symbol at the start of a bit buffer
+    d.base64.assign(d.maxSymLen - d.minSymLen + 1, 0);
+    for (int i = int(d.base64.size()) - 2; i >= 0; --i)
+        d.base64[i] = (d.base64[i + 1] + readLE16(d.lowestSym + 2*i) - readLE16(d.lowestSym + 2*(i + 1))) / 2;
+    for (std::size_t i = 0; i < d.base64.size(); ++i)
+        d.base64[i] <<= 64 - i - d.minSymLen;
+    data += d.base64.size() * 2;
+
+    d.symlen.assign(readLE16(data), 0);
+    data += 2;
+    d.btree = data;
+    std::vector<bool> visited(d.symlen.size());
+    for (std::size_t sym = 0; sym < d.symlen.size(); ++sym)
+        if (!visited[sym])
+            d.symlen[sym] = symbolLength(d, int(sym), visited);
+    return data + d.symlen.size()*3 + (d.symlen.size() & 1);
+}
+
+// DTZ values are stored by frequency per result; the map gives them back,
+// and values kept in moves become plies
+int Table::mapScore(int file, int value, Wdl wdl) const
+{
+    if (m_type==WdlTable)
+        return value - 2;
+
+    static constexpr int wdlMap[] = {1, 3, 0, 2, 0};
+    const Pairs &d = pairs(0, file);
+    if (d.flags & Mapped) {
+        const std::uint32_t at = d.mapIdx[wdlMap[wdl + 2]];
+        value = d.flags & Wide ? readLE16(m_map + at + 2*value) : m_map[at + value];
+    }
+    if ((wdl==Win && !(d.flags & WinPlies)) || (wdl==Loss && !(d.flags & LossPlies))
+        || wdl==CursedWin || wdl==BlessedLoss)
+        value *= 2;
+    return value + 1;
+}
+
+int Table::probe(const ChessBoard &board, Wdl wdl, bool &otherSide) const
+{
+    int stm;
+    int file;
+    std::uint64_t idx;
+    otherSide = !index(board, stm, file, idx);
+    return otherSide ? 0 : mapScore(file, decompress(pairs(stm, file), idx), wdl);
+}
+
+bool Table::index(const ChessBoard &board, int &stm, int &tbFile, std::uint64_t &idx) const
+{
+    const Encoding &e = encoding();
+    const auto pawnsComp = [&e](int a, int b) { return e.mapPawns[a] < e.mapPawns[b]; };
+    std::array<int, MaxPieces> squares{};
+    std::array<int, MaxPieces> pieces{};
+    int size = 0;
+    int leadPawnsCnt = 0;
+    Bitboard leadPawns = 0;
+    tbFile = 0;
+
+    // Tables hold the first side of the name as White. With the other side
+    // stronger, or for symmetric material with Black to move, colours and
+    // ranks are swapped.
+    const bool blackToMove = board.currentColor()==ChessBoard::Black;
+    const std::string material = sidePieces(board, ChessBoard::White) + "v" + sidePieces(board, ChessBoard::Black);
+    const bool flip = (m_key==m_key2 && blackToMove) || material!=m_key;
+    const int flipColor = flip ? 8 : 0;
+    const int flipSquares = flip ? 56 : 0;
+    stm = flip ^ blackToMove;
+
+    // With pawns there is a table per file of the leading pawn: the one
+    // nearest an edge, lowest among those, mirrored to files a-d
+    if (m_hasPawns) {
+        const int pc = pairs(0, 0).pieces[0] ^ flipColor;
+        leadPawns = board.pieceMask(pc >> 3 ? ChessBoard::BP : ChessBoard::WP);
+        for (Bitboard b = leadPawns; b;)
+            squares[size++] = tbSquare(Bitboards::popLsb(b)) ^ flipSquares;
+        leadPawnsCnt = size;
+        std::swap(squares[0], *std::max_element(squares.begin(), squares.begin() + leadPawnsCnt, pawnsComp));
+        tbFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    if (m_type==DtzTable) {
+        const int flags = pairs(stm, tbFile).flags;
+        if ((flags & Stm)!=stm && !(m_key==m_key2 && !m_hasPawns))
+            return false;
+    }
+
+    const Bitboard occupied = board.colorMask(ChessBoard::White) | board.colorMask(ChessBoard::Black);
+    for (Bitboard b = occupied & ~leadPawns; b;) {
+        const int sq = Bitboards::popLsb(b);
+        squares[size] = tbSquare(sq) ^ flipSquares;
+        pieces[size++] = tbPiece(board.pieceAt(sq)) ^ flipColor;
+    }
+
+    // Same order of pieces as the table
+    const Pairs &d = pairs(stm, tbFile);
+    for (int i = leadPawnsCnt; i < size - 1; ++i)
+        for (int j = i + 1; j < size; ++j)
+            if (d.pieces[i]==pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+
+    // The leading piece goes to files a-d
+    if (fileOf(squares[0]) > 3)
+        for (int i = 0; i < size; ++i)
+            squares[i] ^= 7;
+
+    if (m_hasPawns) {
+        idx = e.leadPawnIdx[leadPawnsCnt][squares[0]];
+        std::stable_sort(squares.begin() + 1, squares.begin() + leadPawnsCnt, pawnsComp);
+        for (int i = 1; i < leadPawnsCnt; ++i)
+            idx += e.binomial[i][e.mapPawns[squares[i]]];
+    } else {
+        // Without pawns, also to ranks 1-4 and below the a1-h8 diagonal
+        if (rankOf(squares[0]) > 3)
+            for (int i = 0; i < size; ++i)
+                squares[i] ^= 56;
+        for (int i = 0; i < d.groupLen[0]; ++i) {
+            if (!offA1H8(squares[i]))
+                continue;
+            if (offA1H8(squares[i]) > 0)
+                for (int j = i; j < size; ++j)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            break;
+        }
+
+        if (m_hasUniquePieces) {
+            // Three unique pieces together: 10 squares for the first (the
+            // triangle), 63 and 62 left for the others, with the cases of
+            // pieces on the diagonal counted after the others
+            const int adjust1 = squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offA1H8(squares[0]))
+                idx = (std::uint64_t(e.mapA1D1D4[squares[0]]) * 63 + (squares[1] - adjust1)) * 62
+                    + squares[2] - adjust2;
+            else if (offA1H8(squares[1]))
+                idx = (6 * 63 + std::uint64_t(rankOf(squares[0])) * 28 + e.mapB1H1H7[squares[1]]) * 62
+                    + squares[2] - adjust2;
+            else if (offA1H8(squares[2]))
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28
+                    + (rankOf(squares[1]) - adjust1) * 28 + e.mapB1H1H7[squares[2]];
+            else
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6
+                    + (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2);
+        } else {
+            idx = e.mapKK[e.mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The other groups, each sorted, skip the squares of earlier groups
+    idx *= d.groupIdx[0];
+    int *groupSq = squares.data() + d.groupLen[0];
+    bool remainingPawns = m_hasPawns && m_pawnCount[1];
+    for (int next = 1; d.groupLen[next]; ++next) {
+        std::stable_sort(groupSq, groupSq + d.groupLen[next]);
+        std::uint64_t n = 0;
+        for (int i = 0; i < d.groupLen[next]; ++i) {
+            const auto adjust = std::count_if(squares.data(), groupSq, [&](int s) { return groupSq[i] > s; });
+            n += e.binomial[i + 1][groupSq[i] - adjust - 8*remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d.groupIdx[next];
+        groupSq += d.groupLen[next];
+    }
+    return true;
+}
+
+int Prober::probeTable(const ChessBoard &board, Table::Type type, Wdl wdl, State &state, bool &otherSide)
+{
+    otherSide = false;
+    if (pieceCount(board)==2)
+        return Draw;
+    const Table *t = table(type, materialName(board));
+    if (!t) {
+        state = Fail;
+        return 0;
+    }
+    return t->probe(board, wdl, otherSide);
+}
+
+// The generator stores "don't care" values where the side to move has a
+// capture at least as good as the stored result, and nothing for en
+// passant, so the captures (and for DTZ the pawn moves) are searched and the
+// best of them and the table value is the result
+Wdl Prober::search(ChessBoard &board, State &state, bool checkZeroingMoves)
+{
+    Wdl best = Loss;
+    MoveList moves;
+    board.legalMoves(moves);
+    int moveCount = 0;
+    for (Move m : moves) {
+        if (!isCapture(board, m) && (!checkZeroingMoves || !isPawn(board.pieceAt(m.from()))))
+            continue;
+        ++moveCount;
+        ChessBoard::Undo undo;
+        board.makeMove(m, undo);
+        const Wdl value = Wdl(-search(board, state, false));
+        board.unmakeMove(m, undo);
+        if (state==Fail)
+            return Draw;
+        if (value > best) {
+            best = value;
+            if (value >= Win) {
+                state = ZeroingBestMove;
+                return value;
+            }
+        }
+    }
+
+    // With every move searched the table is not needed, and may be wrong
+    const bool noMoreMoves = moveCount && moveCount==moves.size();
+    Wdl value = best;
+    if (!noMoreMoves) {
+        bool otherSide;
+        value = Wdl(probeTable(board, Table::WdlTable, Draw, state, otherSide));
+        if (state==Fail)
+            return Draw;
+    }
+    if (best >= value) {
+        state = best > Draw || noMoreMoves ? ZeroingBestMove : Ok;
+        return best;
+    }
+    state = Ok;
+    return value;
+}
+
+int Prober::dtz(ChessBoard &board, State &state)
+{
+    state = Ok;
+    const Wdl wdl = search(board, state, true);
+    if (state==Fail || wdl==Draw)
+        return 0;
+    if (state==ZeroingBestMove)
+        return dtzBeforeZeroing(wdl);
+
+    bool otherSide;
+    int value = probeTable(board, Table::DtzTable, wdl, state, otherSide);
+    if (state==Fail)
+        return 0;
+    if (!otherSide)
+        return (value + 100*(wdl==BlessedLoss || wdl==CursedWin)) * signOf(wdl);
+
+    // The table holds the other side to move: the best reply decides
+    int best = 0xFFFF;
+    MoveList moves;
+    board.legalMoves(moves);
+    for (Move m : moves) {
+        const bool zeroing = isCapture(board, m) || isPawn(board.pieceAt(m.from()));
+        ChessBoard::Undo undo;
+        board.makeMove(m, undo);
+        value = zeroing ? -dtzBeforeZeroing(search(board, state, false)) : -dtz(board, state);
+        if (value==1 && board.isInCheck(board.currentColor()) && !board.hasMoves(board.currentColor()))
+            best = 1;
+        if (!zeroing)
+            value += signOf(value);
+        if (value < best && signOf(value)==signOf(wdl))
+            best = value;
+        board.unmakeMove(m, undo);
+        if (state==Fail)
+            return 0;
+    }
+    return best==0xFFFF ? -1 : best;
+}
+
+bool Prober::probeWdl(ChessBoard &board, Wdl &wdl)
+{
+    if (board.castlingRights() || pieceCount(board) > MaxPieces)
+        return false;
+    State state = Ok;
+    wdl = search(board, state, false);
+    return state!=Fail;
+}
+
+bool Prober::probeDtz(ChessBoard &board, int &value)
+{
+    if (board.castlingRights() || pieceCount(board) > MaxPieces)
+        return false;
+    State state = Ok;
+    value = dtz(board, state);
+    return state!=Fail;
+}
+
+bool Prober::probeRoot(ChessBoard &board, RootMove &best)
+{
+    if (board.castlingRights() || pieceCount(board) > MaxPieces)
+        return false;
+    MoveList moves;
+    board.legalMoves(moves);
+    if (moves.isEmpty())
+        return false;
+
+    const int rule50 = board.halfmoveClock();
+    int bestRank = -MaxDtz - 1;
+    for (Move m : moves) {
+        ChessBoard::Undo undo;
+        board.makeMove(m, undo);
+        State state = Ok;
+        int value;
+        if (board.halfmoveClock()==0) {
+            value = dtzBeforeZeroing(Wdl(-search(board, state, false)));
+        } else if (board.halfmoveClock() >= 100 || board.isThreefoldRepetition()) {
+            value = 0;
+        } else {
+            value = -dtz(board, state);
+            value += signOf(value);
+        }
+        const ChessBoard::Color them = board.currentColor();
+        if (value==2 && board.isInCheck(them) && !board.hasMoves(them))
+            value = 1;
+        board.unmakeMove(m, undo);
+        if (state==Fail)
+            return false;
+
+        // Wins the 50-move rule allows rank equally, the others by how far
+        // past the limit they fall; likewise for losses
+        const int rank = value > 0 ? (value + rule50 <= 99 ? MaxDtz : MaxDtz - (value + rule50))
+                       : value < 0 ? (-value*2 + rule50 < 100 ? -MaxDtz : -MaxDtz + (-value + rule50))
+                       : 0;
+        // Among equals the quickest win or the slowest loss
+        if (rank > bestRank || (rank==bestRank && value < best.dtz)) {
+            bestRank = rank;
+            best.move = m;
+            best.dtz = value;
+        }
+    }
+    // The result is whether the zeroing move comes within the 50-move
+    // rule, whatever band the move was ranked in
+    const int plies = std::abs(best.dtz) + rule50;
+    best.wdl = best.dtz > 0 ? (plies <= 100 ? Win : CursedWin)
+             : best.dtz < 0 ? (plies <= 100 ? Loss : BlessedLoss)
+             : Draw;
+    return true;
+}
+
+} // namespace Syzygy
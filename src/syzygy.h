@@ -0,0 +1,132 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chessboard.h"
+
+// Decoder for Syzygy WDL (.rtbw) and DTZ (.rtbz) tables and the probing
+// rules on top of them, after the reference implementation in Stockfish and
+// Fathom. Standard library only: the tables are read in place from memory
+// that a subclass of Prober maps and owns.
+namespace Syzygy {
+
+// Result for the side to move. Cursed wins and blessed losses are wins and
+// losses that the 50-move rule turns into draws.
+enum Wdl { Loss = -2, BlessedLoss = -1, Draw = 0, CursedWin = 1, Win = 2 };
+
+constexpr int MaxPieces = 7;
+
+// Table name for the material on the board, such as "KRPvKR", with the
+// side that has more material first as in the file names
+std::string materialName(const ChessBoard &board);
+
+// One table file. Pointers into the file data are kept, so the data must
+// stay mapped for as long as the table is used.
+class Table
+{
+public:
+    enum Type { WdlTable, DtzTable };
+
+    // Checks the header and reads the layout; name is the file name
+    // without extension, such as "KRvK"
+    bool init(Type type, const std::string &name, const std::uint8_t *data, std::size_t size);
+    Type type() const { return m_type; }
+
+    // Stored value for the position: a Wdl for WDL tables, plies (or moves,
+    // see the flags) to the next capture or pawn move for DTZ tables, which
+    // need the position's Wdl. DTZ tables hold one side to move only;
+    // otherSide is set when the position is the other one.
+    int probe(const ChessBoard &board, Wdl wdl, bool &otherSide) const;
+
+    // Index decoding state for one side to move and, with pawns, one file
+    // of the leading pawn
+    struct Pairs
+    {
+        std::uint8_t flags = 0;
+        std::uint8_t maxSymLen = 0;
+        std::uint8_t minSymLen = 0;
+        std::uint32_t numBlocks = 0;
+        std::size_t blockSize = 0;
+        std::size_t span = 0;
+        const std::uint8_t *lowestSym = nullptr;
+        const std::uint8_t *btree = nullptr;
+        const std::uint8_t *blockLength = nullptr;
+        std::uint32_t blockLengthSize = 0;
+        const std::uint8_t *sparseIndex = nullptr;
+        std::size_t sparseIndexSize = 0;
+        const std::uint8_t *data = nullptr;
+        std::vector<std::uint64_t> base64;
+        std::vector<std::uint8_t> symlen;
+        std::array<int, MaxPieces> pieces{};
+        std::array<std::uint64_t, MaxPieces + 1> groupIdx{};
+        std::array<int, MaxPieces + 1> groupLen{};
+        std::array<std::uint32_t, 4> mapIdx{}; // DTZ value maps by Wdl
+    };
+
+private:
+    const Pairs &pairs(int stm, int file) const { return m_pairs[stm % m_sides][m_hasPawns ? file : 0]; }
+    Pairs &pairs(int stm, int file) { return m_pairs[stm % m_sides][m_hasPawns ? file : 0]; }
+    // Position number in the table, and the side to move and file of the
+    // leading pawn that pick its Pairs; false if the side is not stored
+    bool index(const ChessBoard &board, int &stm, int &file, std::uint64_t &idx) const;
+    void setGroups(Pairs &d, const int order[2], int file);
+    const std::uint8_t *setSizes(Pairs &d, const std::uint8_t *data);
+    int mapScore(int file, int value, Wdl wdl) const;
+
+    Type m_type = WdlTable;
+    std::string m_key;  // material with White as the first side of the name
+    std::string m_key2; // and with Black as the first side
+    int m_pieceCount = 0;
+    bool m_hasPawns = false;
+    bool m_hasUniquePieces = false;
+    std::array<int, 2> m_pawnCount{}; // leading colour, other colour
+    int m_sides = 1;
+    const std::uint8_t *m_map = nullptr; // DTZ value maps
+    std::array<std::array<Pairs, 4>, 2> m_pairs;
+};
+
+// WDL and DTZ probing with the captures and en passant moves the tables
+// leave out resolved by a small search. Positions with castling rights are
+// not in the tables and fail.
+class Prober
+{
+public:
+    virtual ~Prober() = default;
+
+    // Result of the position for the side to move
+    bool probeWdl(ChessBoard &board, Wdl &wdl);
+    // Plies to the next capture or pawn move on the way to the result,
+    // positive when winning, 0 for draws; 1 and 101 mark a winning or
+    // cursed zeroing move, -1 a mate
+    bool probeDtz(ChessBoard &board, int &dtz);
+
+    struct RootMove
+    {
+        Move move;
+        Wdl wdl = Draw; // for the side to move, counting the 50-move rule
+        int dtz = 0;    // from the root, as probeDtz
+    };
+    // The move the tables rate best: the fastest conversion of a win the
+    // 50-move rule still allows, else a draw, else the longest resistance.
+    // Fails when a table is missing or the position has no moves.
+    bool probeRoot(ChessBoard &board, RootMove &best);
+
+protected:
+    // The table for a material name, stronger side first; nullptr if it is
+    // not available. The table must stay valid until the next call.
+    virtual const Table *table(Table::Type type, const std::string &name) = 0;
+
+private:
+    enum State { Ok, Fail, ZeroingBestMove };
+    int probeTable(const ChessBoard &board, Table::Type type, Wdl wdl, State &state, bool &otherSide);
+    Wdl search(ChessBoard &board, State &state, bool checkZeroingMoves);
+    int dtz(ChessBoard &board, State &state);
+};
+
+} // namespace Syzygy
+
+#endif // SYZYGY_H
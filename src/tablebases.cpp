@@ -0,0 +1,79 @@
+#include "tablebases.h"
+#include <algorithm>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+void Tablebases::setPath(const QString &path)
+{
+    m_path = path;
+    m_wdl.clear();
+    m_dtz.clear();
+    m_mapped.clear();
+    m_maxPieces = 0;
+    for (const QString &dir : path.split(QDir::listSeparator(), Qt::SkipEmptyParts)) {
+        const QFileInfoList files = QDir(dir).entryInfoList({"*.rtbw", "*.rtbz"}, QDir::Files);
+        for (const QFileInfo &file : files) {
+            const QString name = file.completeBaseName();
+            // The first directory that has a table wins, as in Stockfish
+            if (file.suffix()=="rtbw") {
+                if (!m_wdl.contains(name))
+                    m_wdl.insert(name, file.filePath());
+                m_maxPieces = qMax(m_maxPieces, int(name.size()) - 1); // minus the 'v'
+            } else if (!m_dtz.contains(name)) {
+                m_dtz.insert(name, file.filePath());
+            }
+        }
+    }
+    m_maxPieces = qMin(m_maxPieces, Syzygy::MaxPieces);
+}
+
+bool Tablebases::covers(const ChessBoard &board) const
+{
+    if (m_wdl.isEmpty())
+        return false;
+    const int pieces = Bitboards::popCount(board.colorMask(ChessBoard::White) | board.colorMask(ChessBoard::Black));
+    // Castling rights are outside the tables
+    if (pieces>m_maxPieces || board.castlingRights()!=0)
+        return false;
+    const QString key = QString::fromStdString(Syzygy::materialName(board));
+    return m_wdl.contains(key) && m_dtz.contains(key);
+}
+
+const Syzygy::Table *Tablebases::table(Syzygy::Table::Type type, const std::string &name)
+{
+    const QString key = QString::fromStdString(name);
+    for (const auto &m : m_mapped) {
+        if (m->type==type && m->name==key) {
+            m->lastUse = ++m_useCount;
+            return &m->table;
+        }
+    }
+
+    QHash<QString, QString> &files = type==Syzygy::Table::WdlTable ? m_wdl : m_dtz;
+    const auto it = files.constFind(key);
+    if (it==files.constEnd())
+        return nullptr;
+
+    auto m = std::make_unique<Mapped>();
+    m->name = key;
+    m->type = type;
+    m->file.setFileName(it.value());
+    // The mapping lives as long as the file stays open
+    const uchar *data = m->file.open(QIODevice::ReadOnly) ? m->file.map(0, m->file.size()) : nullptr;
+    if (!data || !m->table.init(type, name, data, std::size_t(m->file.size()))) {
+        qWarning() << "Ignoring unreadable tablebase file" << it.value();
+        files.erase(it);
+        return nullptr;
+    }
+    m->lastUse = ++m_useCount;
+
+    if (int(m_mapped.size())>=MaxMapped) {
+        const auto oldest = std::min_element(m_mapped.begin(), m_mapped.end(),
+                                             [](const auto &a, const auto &b) { return a->lastUse < b->lastUse; });
+        *oldest = std::move(m);
+        return &(*oldest)->table;
+    }
+    m_mapped.push_back(std::move(m));
+    return &m_mapped.back()->table;
+}
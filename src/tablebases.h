@@ -0,0 +1,52 @@
+#ifndef TABLEBASES_H
+#define TABLEBASES_H
+
+#include <memory>
+#include <vector>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include "chessboard.h"
+#include "syzygy.h"
+
+// Syzygy tables in local directories, probed in-tree. Files are mapped with
+// QFile::map when first needed; only the most recently used ones stay
+// mapped, so a full 6-piece set does not fill the address space.
+class Tablebases : public Syzygy::Prober
+{
+public:
+    // Directories separated like PATH; nothing outside them is read
+    void setPath(const QString &path);
+    QString path() const { return m_path; }
+    bool isEmpty() const { return m_wdl.isEmpty(); }
+    int maxPieces() const { return m_maxPieces; }
+    int tableCount() const { return int(m_wdl.size()); }
+
+    // Cheap check before probing: few enough pieces, no castling rights and
+    // WDL and DTZ files for the material on the board. Probes may still
+    // fail on a missing table for a capture or a damaged file.
+    bool covers(const ChessBoard &board) const;
+
+protected:
+    const Syzygy::Table *table(Syzygy::Table::Type type, const std::string &name) override;
+
+private:
+    struct Mapped
+    {
+        QString name;
+        Syzygy::Table::Type type;
+        QFile file;
+        Syzygy::Table table;
+        quint64 lastUse = 0;
+    };
+    static constexpr int MaxMapped = 16;
+
+    QString m_path;
+    QHash<QString, QString> m_wdl; // table name to file path
+    QHash<QString, QString> m_dtz;
+    int m_maxPieces = 0;
+    std::vector<std::unique_ptr<Mapped>> m_mapped;
+    quint64 m_useCount = 0;
+};
+
+#endif // TABLEBASES_H
@@ -0,0 +1,38 @@
+#include "timemanager.h"
+#include <algorithm>
+
+namespace {
+
+// Reserved per move for GUI and thread hand-off latency
+constexpr std::int64_t MoveOverhead = 20;
+// Moves the remaining clock is assumed to cover in sudden-death games
+constexpr int DefaultMovesToGo = 30;
+
+} // namespace
+
+void TimeManager::start(const SearchLimits &limits, int color)
+{
+    m_start = std::chrono::steady_clock::now();
+    m_optimum = 0;
+    m_maximum = 0;
+
+    if (limits.moveTime>0) {
+        m_optimum = m_maximum = std::max<std::int64_t>(1, limits.moveTime - MoveOverhead);
+        return;
+    }
+
+    std::int64_t remaining = limits.time[color];
+    if (remaining<=0)
+        return;
+    std::int64_t inc = limits.increment[color];
+    int movesToGo = limits.movesToGo>0 ? std::min(limits.movesToGo, DefaultMovesToGo) : DefaultMovesToGo;
+    std::int64_t usable = std::max<std::int64_t>(1, remaining - MoveOverhead);
+
+    m_optimum = std::min(usable, usable/movesToGo + inc*3/4);
+    // Allow overrunning the plan when an iteration is unfinished, but never
+    // bet more than a fifth of the clock on one move.
+    m_maximum = std::min(usable/5 + inc, m_optimum*4);
+    m_maximum = std::clamp<std::int64_t>(m_maximum, std::min<std::int64_t>(m_optimum, usable), usable);
+    m_optimum = std::max<std::int64_t>(1, m_optimum);
+    m_maximum = std::max<std::int64_t>(1, m_maximum);
+}
@@ -0,0 +1,42 @@
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+
+#include <chrono>
+#include <cstdint>
+
+// What a search may spend. All times are in milliseconds; zero means "not
+// set". With no limit at all the search runs until stopped.
+struct SearchLimits
+{
+    int depth = 0;
+    std::int64_t moveTime = 0;
+    std::int64_t time[2] = {0, 0};      // remaining clock, indexed by ChessBoard::Color
+    std::int64_t increment[2] = {0, 0};
+    int movesToGo = 0;
+    std::uint64_t nodes = 0;
+};
+
+// Turns the clock into a soft budget, checked between iterations, and a
+// hard budget that aborts the running iteration.
+class TimeManager
+{
+public:
+    void start(const SearchLimits &limits, int color);
+
+    std::int64_t elapsed() const
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - m_start).count();
+    }
+    bool softLimitReached() const { return m_optimum>0 && elapsed()>=m_optimum; }
+    bool hardLimitReached() const { return m_maximum>0 && elapsed()>=m_maximum; }
+    std::int64_t optimum() const { return m_optimum; }
+    std::int64_t maximum() const { return m_maximum; }
+
+private:
+    std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+    std::int64_t m_optimum = 0;
+    std::int64_t m_maximum = 0;
+};
+
+#endif // TIMEMANAGER_H
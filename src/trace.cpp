@@ -0,0 +1,321 @@
+#include "trace.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Trace {
+
+#ifndef CHESSQT_NO_TRACING
+const bool enabled = [] {
+    const char *path = std::getenv("CHESSQT_TRACE");
+    return path && *path;
+}();
+#endif
+
+namespace {
+
+// Spans kept per thread; older ones are overwritten but still counted in
+// the histograms
+constexpr std::size_t Capacity = 1 << 16;
+constexpr int Buckets = 64;
+
+struct Event
+{
+    const Point *point;
+    std::int64_t start;
+    std::int64_t duration;
+    int tid;
+};
+
+// Bucket b holds durations of at least 2^(b-1) and below 2^b nanoseconds
+struct Histogram
+{
+    std::uint64_t count = 0;
+    std::int64_t total = 0;
+    std::int64_t max = 0;
+    std::array<std::uint64_t, Buckets> buckets{};
+
+    void add(std::int64_t ns)
+    {
+        ns = std::max<std::int64_t>(ns, 0);
+        ++count;
+        total += ns;
+        max = std::max(max, ns);
+        ++buckets[std::bit_width(std::uint64_t(ns))];
+    }
+
+    void merge(const Histogram &h)
+    {
+        count += h.count;
+        total += h.total;
+        max = std::max(max, h.max);
+        for (int b = 0; b < Buckets; ++b)
+            buckets[b] += h.buckets[b];
+    }
+
+    // Upper bound of the bucket holding the given fraction of the spans,
+    // capped by the longest span
+    std::int64_t percentile(double q) const
+    {
+        const double target = q * double(count);
+        std::uint64_t seen = 0;
+        for (int b = 0; b < Buckets; ++b) {
+            seen += buckets[b];
+            if (seen && double(seen) >= target)
+                return b==0 ? 0 : std::min(max, std::int64_t(1) << std::min(b, 62));
+        }
+        return max;
+    }
+};
+
+using Stats = std::array<Histogram, Point::MaxPoints>;
+
+// Written only by the thread that owns it. When the thread exits its
+// statistics are retired and the ring goes to the next new thread, which
+// gets a tid of its own; every event carries the tid of its writer.
+struct Buffer
+{
+    int tid = 0;
+    std::vector<Event> events = std::vector<Event>(Capacity);
+    std::uint64_t written = 0;
+    Stats stats{};
+};
+
+std::string formatNs(double ns)
+{
+    char text[32];
+    if (ns < 1e3)
+        std::snprintf(text, sizeof(text), "%.0fns", ns);
+    else if (ns < 1e6)
+        std::snprintf(text, sizeof(text), "%.1fus", ns / 1e3);
+    else
+        std::snprintf(text, sizeof(text), "%.2fms", ns / 1e6);
+    return text;
+}
+
+void writeString(std::FILE *f, const char *s)
+{
+    std::fputc('"', f);
+    for (; *s; ++s) {
+        if (static_cast<unsigned char>(*s) < 0x20)
+            continue;
+        if (*s=='"' || *s=='\\')
+            std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+const std::int64_t s_epoch = now();
+std::atomic<bool> s_stopped{false};
+
+class Registry
+{
+public:
+    Registry()
+    {
+        if (enabled)
+            m_path = std::getenv("CHESSQT_TRACE");
+    }
+
+    int addPoint(const Point &point, std::atomic<int> &id)
+    {
+        std::lock_guard lock(m_mutex);
+        int value = id.load(std::memory_order_relaxed);
+        if (value==-2) {
+            value = m_points.size() < std::size_t(Point::MaxPoints) ? int(m_points.size()) : -1;
+            if (value >= 0)
+                m_points.push_back(&point);
+            id.store(value, std::memory_order_release);
+        }
+        return value;
+    }
+
+    Buffer *acquire()
+    {
+        std::lock_guard lock(m_mutex);
+        Buffer *buffer;
+        if (!m_free.empty()) {
+            buffer = m_free.back();
+            m_free.pop_back();
+        } else {
+            m_buffers.push_back(std::make_unique<Buffer>());
+            buffer = m_buffers.back().get();
+        }
+        m_threadNames.emplace_back();
+        buffer->tid = int(m_threadNames.size());
+        return buffer;
+    }
+
+    void release(Buffer *buffer)
+    {
+        std::lock_guard lock(m_mutex);
+        for (int p = 0; p < Point::MaxPoints; ++p)
+            m_retired[p].merge(buffer->stats[p]);
+        buffer->stats = Stats{};
+        m_free.push_back(buffer);
+    }
+
+    void setThreadName(int tid, const char *name)
+    {
+        std::lock_guard lock(m_mutex);
+        m_threadNames[tid - 1] = name;
+    }
+
+    void shutdown()
+    {
+        std::lock_guard lock(m_mutex);
+        if (s_stopped.exchange(true))
+            return;
+        writeTrace();
+        printSummary();
+    }
+
+private:
+    std::string threadName(int tid) const
+    {
+        const std::string &name = m_threadNames[tid - 1];
+        return name.empty() ? "thread " + std::to_string(tid) : name;
+    }
+
+    void writeTrace() const
+    {
+        std::FILE *f = std::fopen(m_path.c_str(), "w");
+        if (!f) {
+            std::fprintf(stderr, "trace: cannot write %s\n", m_path.c_str());
+            return;
+        }
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+        for (int tid = 1; tid <= int(m_threadNames.size()); ++tid) {
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                         tid==1 ? "" : ",\n", tid);
+            writeString(f, threadName(tid).c_str());
+            std::fputs("}}", f);
+        }
+        for (const auto &buffer : m_buffers) {
+            const std::uint64_t kept = std::min<std::uint64_t>(buffer->written, Capacity);
+            for (std::uint64_t i = buffer->written - kept; i < buffer->written; ++i) {
+                const Event &e = buffer->events[i % Capacity];
+                std::fputs(",\n{\"name\":", f);
+                writeString(f, e.point->name());
+                std::fprintf(f, ",\"cat\":\"chessqt\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                             double(e.start - s_epoch) / 1e3, double(e.duration) / 1e3, e.tid);
+            }
+        }
+        std::fputs("\n]}\n", f);
+        std::fclose(f);
+    }
+
+    void printSummary() const
+    {
+        Stats totals = m_retired;
+        std::uint64_t spans = 0;
+        std::uint64_t kept = 0;
+        for (const auto &buffer : m_buffers) {
+            spans += buffer->written;
+            kept += std::min<std::uint64_t>(buffer->written, Capacity);
+            for (std::size_t p = 0; p < m_points.size(); ++p)
+                totals[p].merge(buffer->stats[p]);
+        }
+        std::fprintf(stderr, "trace: %llu of %llu spans from %zu threads written to %s\n",
+                     static_cast<unsigned long long>(kept), static_cast<unsigned long long>(spans),
+                     m_threadNames.size(), m_path.c_str());
+        std::fprintf(stderr, "%-28s %10s %10s %9s %9s %9s %9s\n", "point", "calls", "total", "mean", "p50", "p99", "max");
+        for (std::size_t p = 0; p < m_points.size(); ++p) {
+            const Histogram &h = totals[p];
+            if (!h.count)
+                continue;
+            std::fprintf(stderr, "%-28s %10llu %10s %9s %9s %9s %9s\n", m_points[p]->name(),
+                         static_cast<unsigned long long>(h.count), formatNs(double(h.total)).c_str(),
+                         formatNs(double(h.total) / double(h.count)).c_str(),
+                         ("<=" + formatNs(double(h.percentile(0.5)))).c_str(),
+                         ("<=" + formatNs(double(h.percentile(0.99)))).c_str(), formatNs(double(h.max)).c_str());
+            std::string line = " ";
+            for (int b = 0; b < Buckets; ++b) {
+                if (!h.buckets[b])
+                    continue;
+                line += " <" + formatNs(b==0 ? 1.0 : double(std::uint64_t(1) << std::min(b, 63)))
+                      + " " + std::to_string(h.buckets[b]);
+            }
+            std::fprintf(stderr, "%s\n", line.c_str());
+        }
+    }
+
+    std::mutex m_mutex;
+    std::string m_path;
+    std::vector<const Point *> m_points;
+    std::vector<std::unique_ptr<Buffer>> m_buffers;
+    std::vector<Buffer *> m_free;
+    std::vector<std::string> m_threadNames; // by tid - 1
+    Stats m_retired{};
+};
+
+// Never destroyed, so threads that outlive main() can still hand their
+// buffers back
+Registry &registry()
+{
+    static Registry *r = new Registry;
+    return *r;
+}
+
+// Hands the buffer back when the thread exits
+struct ThreadSlot
+{
+    Buffer *buffer = nullptr;
+
+    ~ThreadSlot()
+    {
+        if (buffer)
+            registry().release(buffer);
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+Buffer &threadBuffer()
+{
+    if (!t_slot.buffer)
+        t_slot.buffer = registry().acquire();
+    return *t_slot.buffer;
+}
+
+} // namespace
+
+int Point::id() const
+{
+    const int id = m_id.load(std::memory_order_acquire);
+    return id!=-2 ? id : registry().addPoint(*this, m_id);
+}
+
+void record(const Point &point, std::int64_t start, std::int64_t end)
+{
+    if (s_stopped.load(std::memory_order_relaxed))
+        return;
+    const int id = point.id();
+    if (id < 0)
+        return;
+    Buffer &buffer = threadBuffer();
+    buffer.events[buffer.written++ % Capacity] = {&point, start, end - start, buffer.tid};
+    buffer.stats[id].add(end - start);
+}
+
+void setThreadName(const char *name)
+{
+    if (enabled && !s_stopped.load(std::memory_order_relaxed))
+        registry().setThreadName(threadBuffer().tid, name);
+}
+
+void shutdown()
+{
+    if (enabled)
+        registry().shutdown();
+}
+
+} // namespace Trace
@@ -0,0 +1,120 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Scoped timing of hot paths. Tracing is off unless the CHESSQT_TRACE
+// environment variable names an output file, and then a trace point costs one
+// predictable branch. When it is on, every thread records spans into its own
+// ring buffer and per-point histograms without locking. shutdown() writes
+// the buffered spans to that file as a Chrome/Perfetto trace (open it in
+// ui.perfetto.dev or chrome://tracing) and prints call counts and latency
+// histograms to stderr.
+//
+// Building with CHESSQT_NO_TRACING removes the trace points altogether.
+namespace Trace {
+
+#ifdef CHESSQT_NO_TRACING
+inline constexpr bool enabled = false;
+#else
+extern const bool enabled;
+#endif
+
+// A named place in the code. Points are static objects. Each one gets a
+// slot in the per-thread statistics the first time it records, and the
+// slots are limited to MaxPoints.
+class Point
+{
+public:
+    static constexpr int MaxPoints = 64;
+
+    constexpr explicit Point(const char *name) : m_name(name) {}
+    Point(const Point &) = delete;
+    Point &operator=(const Point &) = delete;
+
+    const char *name() const { return m_name; }
+    // Slot of the point, -1 when all slots are taken
+    int id() const;
+
+private:
+    const char *m_name;
+    mutable std::atomic<int> m_id{-2};
+};
+
+// Nanoseconds on a monotonic clock
+inline std::int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records a span on the calling thread. Only call this while tracing is
+// enabled.
+void record(const Point &point, std::int64_t start, std::int64_t end);
+
+// Ends a span that started at `start`, for spans that do not fit one scope,
+// such as a request answered by a later callback. A start of 0 means that
+// the span was never started.
+inline void complete(const Point &point, std::int64_t start)
+{
+    if (enabled && start)
+        record(point, start, now());
+}
+
+// Start time for complete(), or 0 when tracing is off
+inline std::int64_t start() { return enabled ? now() : 0; }
+
+// Shows the calling thread under this name in the trace
+void setThreadName(const char *name);
+
+// Writes the trace and the summary and stops recording. Call it once the
+// threads that record have been joined; later spans are dropped.
+void shutdown();
+
+// Calls shutdown() when it goes out of scope. Declare it in main() right
+// after the application object, so that it runs after every local that
+// owns a recording thread has been destroyed.
+class Session
+{
+public:
+    Session() = default;
+    ~Session() { shutdown(); }
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+};
+
+class Scope
+{
+public:
+    explicit Scope(const Point &point)
+        : m_point(enabled ? &point : nullptr), m_start(m_point ? now() : 0) {}
+    ~Scope()
+    {
+        if (m_point)
+            record(*m_point, m_start, now());
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const Point *m_point;
+    std::int64_t m_start;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block under a string literal name
+#ifdef CHESSQT_NO_TRACING
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#else
+#define TRACE_SCOPE(name) \
+    static constinit const Trace::Point TRACE_CONCAT(tracePoint_, __LINE__)(name); \
+    const Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(TRACE_CONCAT(tracePoint_, __LINE__))
+#endif
+
+#endif // TRACE_H
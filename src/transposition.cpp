@@ -0,0 +1,103 @@
+#include "transposition.h"
+#include <algorithm>
+
+TranspositionTable::TranspositionTable(std::size_t megabytes)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(std::size_t megabytes)
+{
+    std::size_t count = std::max<std::size_t>(1, (megabytes << 20) / sizeof(Bucket));
+    if (count==m_bucketCount)
+        return clear();
+    m_buckets.reset(new Bucket[count]);
+    m_bucketCount = count;
+    m_generation = 0;
+}
+
+void TranspositionTable::clear()
+{
+    for (std::size_t i = 0; i < m_bucketCount; ++i) {
+        for (Slot &s : m_buckets[i].entries) {
+            s.check.store(0, std::memory_order_relaxed);
+            s.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_generation = 0;
+}
+
+// Layout: move:16 | score:16 | eval:16 | depth:8 | bound:2 | generation:6
+std::uint64_t TranspositionTable::pack(const Entry &e, std::uint8_t generation)
+{
+    return std::uint64_t(e.move)
+         | std::uint64_t(std::uint16_t(e.score)) << 16
+         | std::uint64_t(std::uint16_t(e.eval)) << 32
+         | std::uint64_t(e.depth) << 48
+         | std::uint64_t(e.bound & 3) << 56
+         | std::uint64_t(generation & 0x3F) << 58;
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(std::uint64_t data)
+{
+    Entry e;
+    e.move = std::uint16_t(data);
+    e.score = std::int16_t(std::uint16_t(data >> 16));
+    e.eval = std::int16_t(std::uint16_t(data >> 32));
+    e.depth = std::uint8_t(data >> 48);
+    e.bound = Bound((data >> 56) & 3);
+    return e;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, Entry &entry) const
+{
+    for (const Slot &s : bucketFor(key).entries) {
+        std::uint64_t data = s.data.load(std::memory_order_relaxed);
+        if (data && (s.check.load(std::memory_order_relaxed) ^ data)==key) {
+            entry = unpack(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, const Entry &entry)
+{
+    Bucket &b = bucketFor(key);
+    Slot *victim = &b.entries[0];
+    int worst = 1 << 30;
+    Entry e = entry;
+    for (Slot &s : b.entries) {
+        std::uint64_t data = s.data.load(std::memory_order_relaxed);
+        if (data && (s.check.load(std::memory_order_relaxed) ^ data)==key) {
+            // Keep the known best move when the new result has none
+            if (!e.move)
+                e.move = std::uint16_t(data);
+            victim = &s;
+            break;
+        }
+        // Prefer empty, then stale, then shallow slots
+        int age = (m_generation - int(data >> 58)) & 0x3F;
+        int value = data ? int((data >> 48) & 0xFF) - 8*age : -(1 << 20);
+        if (value < worst) {
+            worst = value;
+            victim = &s;
+        }
+    }
+    std::uint64_t data = pack(e, m_generation);
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+    victim->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    std::size_t sample = std::min<std::size_t>(m_bucketCount, 250);
+    int used = 0;
+    for (std::size_t i = 0; i < sample; ++i) {
+        for (const Slot &s : m_buckets[i].entries) {
+            std::uint64_t data = s.data.load(std::memory_order_relaxed);
+            used += data && int(data >> 58)==m_generation;
+        }
+    }
+    return sample ? int(used * 1000 / (sample * BucketSize)) : 0;
+}
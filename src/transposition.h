@@ -0,0 +1,67 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed-size hash table keyed by ChessBoard::key(). Every slot packs its
+// payload into one 64-bit word stored next to key^payload, so readers and
+// writers on any number of threads need no locks: a slot torn by a
+// concurrent write simply fails the key check and reads as a miss.
+class TranspositionTable
+{
+public:
+    enum Bound : std::uint8_t { BoundNone, BoundUpper, BoundLower, BoundExact };
+
+    struct Entry
+    {
+        std::uint16_t move = 0;
+        std::int16_t score = 0;
+        std::int16_t eval = 0;
+        std::uint8_t depth = 0;
+        Bound bound = BoundNone;
+    };
+
+    explicit TranspositionTable(std::size_t megabytes = 16);
+
+    void resize(std::size_t megabytes);
+    void clear();
+    // Starts a new search generation so older entries are replaced first
+    void newSearch() { m_generation = (m_generation + 1) & 0x3F; }
+
+    bool probe(std::uint64_t key, Entry &entry) const;
+    void store(std::uint64_t key, const Entry &entry);
+    // Permille of sampled slots written during the current generation
+    int hashfull() const;
+    std::size_t sizeInBytes() const { return m_bucketCount * sizeof(Bucket); }
+
+private:
+    static constexpr int BucketSize = 4;
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    struct alignas(64) Bucket
+    {
+        Slot entries[BucketSize];
+    };
+
+    static std::uint64_t pack(const Entry &e, std::uint8_t generation);
+    static Entry unpack(std::uint64_t data);
+    Bucket &bucketFor(std::uint64_t key) const
+    {
+        // Multiply-shift maps the key onto any table size without a modulo
+        return m_buckets[(static_cast<unsigned __int128>(key) * m_bucketCount) >> 64];
+    }
+
+    std::unique_ptr<Bucket[]> m_buckets;
+    std::size_t m_bucketCount = 0;
+    std::uint8_t m_generation = 0;
+};
+
+#endif // TRANSPOSITION_H
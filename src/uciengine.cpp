@@ -0,0 +1,266 @@
+#include "uciengine.h"
+#include <algorithm>
+
+namespace {
+
+// Consecutive crashes tolerated before giving up until start() is called
+constexpr int MaxRestarts = 5;
+// An engine that has not answered the handshake by then is considered hung
+constexpr int HandshakeTimeoutMs = 10000;
+
+} // namespace
+
+UciEngine::UciEngine(QObject *parent)
+    : QObject(parent)
+{
+    m_restartTimer.setSingleShot(true);
+    connect(&m_restartTimer, &QTimer::timeout, this, &UciEngine::start);
+    m_handshakeTimer.setSingleShot(true);
+    connect(&m_handshakeTimer, &QTimer::timeout, this, [this] {
+        scheduleRestart("engine did not answer the UCI handshake");
+    });
+}
+
+UciEngine::~UciEngine()
+{
+    shutdown();
+}
+
+void UciEngine::setState(State state)
+{
+    if (m_state==state)
+        return;
+    m_state = state;
+    emit stateChanged(state);
+    if (state==Ready)
+        emit ready();
+}
+
+void UciEngine::start()
+{
+    if (m_state!=Stopped && m_state!=Failed)
+        return;
+    if (m_state==Failed)
+        m_restarts = 0;
+    m_shuttingDown = false;
+    m_restartTimer.stop();
+    if (m_process)
+        m_process->deleteLater();
+
+    m_process = new QProcess(this);
+    connect(m_process, &QProcess::started, this, &UciEngine::onStarted);
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &UciEngine::onReadyRead);
+    connect(m_process, &QProcess::errorOccurred, this, &UciEngine::onErrorOccurred);
+    connect(m_process, &QProcess::finished, this, &UciEngine::onFinished);
+    setState(Starting);
+    m_process->setProgram(m_program);
+    m_process->start();
+}
+
+void UciEngine::shutdown()
+{
+    m_shuttingDown = true;
+    m_restartTimer.stop();
+    m_handshakeTimer.stop();
+    m_queue.clear();
+    m_search.clear();
+    if (m_process) {
+        disconnect(m_process, nullptr, this, nullptr);
+        if (m_process->state()!=QProcess::NotRunning) {
+            m_process->write("quit\n");
+            m_process->closeWriteChannel();
+            // The engine normally exits on quit; make sure it does not linger
+            if (!m_process->waitForFinished(200))
+                m_process->kill();
+        }
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+    setState(Stopped);
+}
+
+void UciEngine::send(const QByteArray &command)
+{
+    if (m_state==Ready)
+        write(command);
+    else
+        m_queue.append(command);
+}
+
+void UciEngine::setOption(const QByteArray &name, const QByteArray &value)
+{
+    send("setoption name " + name + " value " + value);
+}
+
+void UciEngine::newGame()
+{
+    if (m_state!=Ready) {
+        send("ucinewgame");
+        return;
+    }
+    write("ucinewgame");
+    setState(WaitingReadyOk);
+    write("isready");
+}
+
+void UciEngine::go(const QByteArray &position, const QByteArray &goCommand)
+{
+    m_search = {position, goCommand};
+    m_pondering = false;
+    ++m_outstanding;
+    send(position);
+    send(goCommand);
+}
+
+void UciEngine::goPonder(const QByteArray &position, const QByteArray &goCommand)
+{
+    QByteArray ponder = goCommand;
+    ponder.insert(2, " ponder");
+    m_search = {position, ponder};
+    m_ponderGo = goCommand;
+    m_pondering = true;
+    ++m_outstanding;
+    send(position);
+    send(ponder);
+}
+
+void UciEngine::ponderHit()
+{
+    if (!m_pondering)
+        return;
+    // The engine keeps its tree and carries on as a normal search
+    m_pondering = false;
+    if (m_search.size()==2)
+        m_search[1] = m_ponderGo;
+    send("ponderhit");
+}
+
+void UciEngine::stop()
+{
+    // A search still sitting in the queue never reaches the engine
+    for (int i = m_queue.size()-1; i >= 0; --i) {
+        if (m_queue[i].startsWith("go")) {
+            m_queue.removeAt(i);
+            if (i>0 && m_queue[i-1].startsWith("position"))
+                m_queue.removeAt(i-1);
+            --m_outstanding;
+        }
+    }
+    m_search.clear();
+    m_searchSent = false;
+    m_pondering = false;
+    if (m_outstanding>m_discard) {
+        m_discard = m_outstanding;
+        send("stop");
+    }
+}
+
+void UciEngine::write(const QByteArray &command)
+{
+    if (!m_process)
+        return;
+    if (command.startsWith("go"))
+        m_searchSent = true;
+    m_process->write(command.endsWith('\n') ? command : command + '\n');
+}
+
+void UciEngine::flushQueue()
+{
+    const QList<QByteArray> queued = m_queue;
+    m_queue.clear();
+    for (const QByteArray &command : queued)
+        write(command);
+}
+
+void UciEngine::onStarted()
+{
+    setState(WaitingUciOk);
+    m_handshakeTimer.start(HandshakeTimeoutMs);
+    write("uci");
+}
+
+void UciEngine::onReadyRead()
+{
+    while (m_process && m_process->canReadLine())
+        handleLine(m_process->readLine().trimmed());
+}
+
+void UciEngine::handleLine(const QByteArray &line)
+{
+    if (line.isEmpty())
+        return;
+    emit lineReceived(QString::fromUtf8(line));
+
+    if (m_state==WaitingUciOk && line=="uciok") {
+        setState(WaitingReadyOk);
+        write("isready");
+    } else if (m_state==WaitingReadyOk && line=="readyok") {
+        m_handshakeTimer.stop();
+        m_restarts = 0;
+        setState(Ready);
+        flushQueue();
+    } else if (line.startsWith("info ")) {
+        // Reports before a discarded bestmove belong to the stopped search
+        UciInfo info;
+        if (m_discard==0 && UciInfo::parse(line, info))
+            emit info(info);
+    } else if (line.startsWith("bestmove")) {
+        const QList<QByteArray> parts = line.split(' ');
+        if (m_outstanding>0)
+            --m_outstanding;
+        if (m_discard>0) {
+            --m_discard;
+            return;
+        }
+        m_search.clear();
+        m_searchSent = false;
+        m_pondering = false;
+        int ponderIdx = parts.indexOf("ponder");
+        emit bestMove(QString::fromUtf8(parts.value(1)),
+                      ponderIdx>0 ? QString::fromUtf8(parts.value(ponderIdx+1)) : QString());
+    }
+}
+
+void UciEngine::onErrorOccurred(QProcess::ProcessError error)
+{
+    if (error==QProcess::FailedToStart) {
+        m_handshakeTimer.stop();
+        setState(Failed);
+        emit failed(QString("Failed to start %1: %2").arg(m_program, m_process->errorString()));
+    }
+}
+
+void UciEngine::onFinished(int exitCode, QProcess::ExitStatus status)
+{
+    if (m_shuttingDown)
+        return;
+    scheduleRestart(status==QProcess::CrashExit ? QString("engine crashed")
+                                                : QString("engine exited with code %1").arg(exitCode));
+}
+
+void UciEngine::scheduleRestart(const QString &reason)
+{
+    m_handshakeTimer.stop();
+    if (m_process) {
+        disconnect(m_process, nullptr, this, nullptr);
+        m_process->kill();
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+    // A search the engine was working on is replayed ahead of queued work,
+    // still pondering if it was, so a later ponderhit or stop applies to it
+    if (m_searchSent && !m_search.isEmpty())
+        m_queue = m_search + m_queue;
+    m_searchSent = false;
+    m_outstanding = int(std::count_if(m_queue.cbegin(), m_queue.cend(),
+                                      [](const QByteArray &c) { return c.startsWith("go"); }));
+    m_discard = 0;
+    if (++m_restarts>MaxRestarts) {
+        setState(Failed);
+        emit failed(reason + ", giving up after repeated restarts");
+        return;
+    }
+    setState(Stopped);
+    // Back off so a binary that dies at once does not spin
+    m_restartTimer.start(qMin(5000, 250 << m_restarts));
+}
@@ -0,0 +1,90 @@
+#ifndef UCIENGINE_H
+#define UCIENGINE_H
+
+#include "uciinfo.h"
+#include <QObject>
+#include <QProcess>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+// Asynchronous client for an external UCI engine process. Nothing here
+// blocks: the process is started in the background, the uci/uciok and
+// isready/readyok handshake is tracked as a state machine, and commands
+// sent before the engine is ready are queued and flushed once it is.
+// When the process dies unexpectedly it is restarted and a search that
+// was running is sent again. Search reports are decoded as each line
+// arrives and delivered through info().
+class UciEngine : public QObject
+{
+    Q_OBJECT
+public:
+    enum State { Stopped, Starting, WaitingUciOk, WaitingReadyOk, Ready, Failed };
+    Q_ENUM(State)
+
+    explicit UciEngine(QObject *parent = nullptr);
+    ~UciEngine() override;
+
+    void setProgram(const QString &program) { m_program = program; }
+    QString program() const { return m_program; }
+    State state() const { return m_state; }
+    bool isSearching() const { return m_outstanding>m_discard; }
+    bool isPondering() const { return m_pondering; }
+
+    void start();
+    void shutdown();
+    // Writes a command now if the engine is ready, otherwise queues it
+    void send(const QByteArray &command);
+    void setOption(const QByteArray &name, const QByteArray &value);
+    // ucinewgame followed by an isready round trip; later commands wait for it
+    void newGame();
+    // Sends a position and a go command as one search
+    void go(const QByteArray &position, const QByteArray &goCommand);
+    // Searches the expected position on the opponent's time. goCommand is
+    // the plain go command that applies once ponderHit() confirms it.
+    void goPonder(const QByteArray &position, const QByteArray &goCommand);
+    void ponderHit();
+    // Stops the running search and drops its bestmove
+    void stop();
+
+signals:
+    void stateChanged(UciEngine::State state);
+    void ready();
+    void bestMove(const QString &move, const QString &ponder);
+    // Progress of the search whose bestmove is still wanted
+    void info(const UciInfo &info);
+    void lineReceived(const QString &line);
+    void failed(const QString &reason);
+
+private slots:
+    void onStarted();
+    void onReadyRead();
+    void onErrorOccurred(QProcess::ProcessError error);
+    void onFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    void setState(State state);
+    void handleLine(const QByteArray &line);
+    void write(const QByteArray &command);
+    void flushQueue();
+    void scheduleRestart(const QString &reason);
+
+    QProcess *m_process = nullptr;
+    QString m_program;
+    State m_state = Stopped;
+    QList<QByteArray> m_queue;
+    // position + go of the running search, replayed after a restart
+    QList<QByteArray> m_search;
+    bool m_searchSent = false;
+    bool m_pondering = false;
+    QByteArray m_ponderGo; // go command that takes over on ponderhit
+    int m_outstanding = 0; // go commands without a bestmove yet
+    int m_discard = 0;     // of those, results nobody wants any more
+    int m_restarts = 0;
+    bool m_shuttingDown = false;
+    QTimer m_restartTimer;
+    QTimer m_handshakeTimer;
+};
+
+#endif // UCIENGINE_H
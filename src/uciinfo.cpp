@@ -0,0 +1,52 @@
+#include "uciinfo.h"
+
+bool UciInfo::parse(const QByteArray &line, UciInfo &info)
+{
+    if (!line.startsWith("info "))
+        return false;
+    const QList<QByteArray> tokens = line.simplified().split(' ');
+    info = UciInfo();
+    bool report = false;
+    for (int i = 1; i < tokens.size(); ++i) {
+        const QByteArray &key = tokens[i];
+        auto next = [&]() -> QByteArray { return i+1 < tokens.size() ? tokens[++i] : QByteArray(); };
+        if (key=="depth") {
+            info.depth = next().toInt();
+        } else if (key=="seldepth") {
+            info.selDepth = next().toInt();
+        } else if (key=="multipv") {
+            info.multiPv = next().toInt();
+        } else if (key=="score") {
+            const QByteArray kind = next();
+            info.isMate = kind=="mate";
+            info.score = next().toInt();
+            info.hasScore = kind=="cp" || kind=="mate";
+            report = report || info.hasScore;
+        } else if (key=="lowerbound") {
+            info.bound = LowerBound;
+        } else if (key=="upperbound") {
+            info.bound = UpperBound;
+        } else if (key=="nodes") {
+            info.nodes = next().toLongLong();
+        } else if (key=="nps") {
+            info.nps = next().toLongLong();
+        } else if (key=="time") {
+            info.time = next().toLongLong();
+        } else if (key=="hashfull") {
+            info.hashFull = next().toInt();
+        } else if (key=="tbhits") {
+            info.tbHits = next().toLongLong();
+        } else if (key=="pv") {
+            // The move list runs to the end of the line
+            while (i+1 < tokens.size())
+                info.pv << QString::fromLatin1(tokens[++i]);
+            report = true;
+        } else if (key=="string") {
+            return false;
+        } else if (key=="currmove" || key=="currmovenumber" || key=="cpuload"
+                   || key=="refutation" || key=="currline") {
+            next();
+        }
+    }
+    return report;
+}
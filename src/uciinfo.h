@@ -0,0 +1,32 @@
+#ifndef UCIINFO_H
+#define UCIINFO_H
+
+#include <QByteArray>
+#include <QStringList>
+
+// One decoded "info" line. Scores are from the point of view of the side
+// to move in the searched position, as UCI sends them.
+struct UciInfo
+{
+    enum Bound { Exact, LowerBound, UpperBound };
+
+    int depth = 0;
+    int selDepth = 0;
+    int multiPv = 1;
+    bool hasScore = false;
+    bool isMate = false;
+    int score = 0;          // centipawns, or moves to mate when isMate
+    Bound bound = Exact;
+    qint64 nodes = 0;
+    qint64 nps = 0;
+    qint64 time = 0;        // milliseconds
+    int hashFull = 0;       // permille
+    qint64 tbHits = 0;      // tablebase probes that found the position
+    QStringList pv;
+
+    // Decodes a single line; false for anything that is not a search
+    // report (currmove-only updates, "info string", other commands)
+    static bool parse(const QByteArray &line, UciInfo &info);
+};
+
+#endif // UCIINFO_H
@@ -0,0 +1,58 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <array>
+#include <cstdint>
+
+// Random keys for incremental position hashing. They are generated at
+// compile time from a fixed seed so keys are stable across builds and runs,
+// which lets hashes be stored on disk.
+namespace Zobrist {
+
+struct Keys
+{
+    std::array<std::array<std::uint64_t, 64>, 13> psq{}; // [ChessBoard::Piece][square], Empty unused
+    std::array<std::uint64_t, 16> castling{};           // [castling rights mask]
+    std::array<std::uint64_t, 8> enPassant{};           // [file]
+    std::uint64_t side = 0;                             // black to move
+};
+
+namespace detail {
+
+constexpr std::uint64_t splitMix(std::uint64_t &s)
+{
+    std::uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr Keys makeKeys()
+{
+    Keys k;
+    std::uint64_t s = 0x43686573735174ULL;
+    for (int p = 1; p < 13; ++p)
+        for (int sq = 0; sq < 64; ++sq)
+            k.psq[p][sq] = splitMix(s);
+    // Castling keys are the XOR of one key per right so that updates can
+    // simply swap the old mask's key for the new one.
+    std::array<std::uint64_t, 4> rights{};
+    for (auto &r : rights)
+        r = splitMix(s);
+    for (int m = 0; m < 16; ++m)
+        for (int i = 0; i < 4; ++i)
+            if (m & (1 << i))
+                k.castling[m] ^= rights[i];
+    for (auto &e : k.enPassant)
+        e = splitMix(s);
+    k.side = splitMix(s);
+    return k;
+}
+
+} // namespace detail
+
+inline constexpr Keys keys = detail::makeKeys();
+
+} // namespace Zobrist
+
+#endif // ZOBRIST_H